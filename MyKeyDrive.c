@@ -11,12 +11,27 @@
  */
 
 #include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
 #include "MyKeyDrive.h"
 #include "MyQueue.h"
 
-#define KEY_EVENT_MSG_QUEUE_SIZE        (10)    /** 按键事件消息队列长度 */
-#define KEY_FILTER_TIME                 (30)    /** 消抖滤波时间，单位ms */
-#define KEY_DBL_INTERVAL                (250)   /** 双击最大间隔时间，单位ms */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define KEY_EVENT_MSG_QUEUE_SIZE        (16)    /** 按键事件消息队列长度，必须是2的幂 */
+#ifndef KEY_FILTER_TIME
+#define KEY_FILTER_TIME                 (30 * MYKEY_TICKS_PER_MS)   /** 消抖滤波时间，默认30ms */
+#endif
+#ifndef KEY_DBL_INTERVAL
+#define KEY_DBL_INTERVAL                (250 * MYKEY_TICKS_PER_MS)  /** 双击最大间隔时间，默认250ms */
+#endif
+#define KEY_EVENT_BCAST_SIZE            (16)    /** 按键事件广播缓冲区长度，必须是2的幂 */
+#define KEY_EVENT_SINK_NUM              (4)     /** 按键事件输出函数最大个数 */
+#define KEY_DEFERRED_CALL_NUM           (16)    /** 一次扫描中最多缓存的延迟回调个数，超过时先调用已缓存的 */
 
 //按键状态
 typedef enum {
@@ -36,101 +51,762 @@ typedef struct {
     unsigned char KeyClickCount;                /** 按键次数计数 */
 } myKeyMsg_t;
 
-//按键属性
-typedef struct myKey {
-    MyKeyHandle KeyID;                          /** 按键对应的ID，每个按键对应唯一的ID */
-    KeyStatusFunc KeyStatus;                    /** 按键按下的判断函数,1表示按下,初始化时指定 */
-    struct myKey *Next_Key;                     /** 下一个按键 */
-    size_t PressTime;                           /** 按键按下持续时间（ms） */
-    size_t FilterCount;                         /** 消抖滤波计时（ms） */
-    size_t RepeatSpeed;                         /** 连续触发周期（ms），初始化时指定 */
-    size_t RepeatCount;                         /** 连续触发周期计时（ms） */
-    size_t LongPressTime;                       /** 长按时间，超过该时间认为是长按（ms），初始化时指定 */
-    size_t DblClkCount;                         /** 双击间隔时间计时（ms） */
-
-    int keyState;                               /** 消抖后的按键状态,1表示按下,0表示弹起 */
-    unsigned char ClickCount;                   /** 连按次数计数 */
-    unsigned char Mode;                         /** 按键支持的检测模式，初始化时指定 */
-    myKeyState_t State;                         /** 按键当前状态 */
-} myKey_t;
-
-static myKey_t *MyKeyList = NULL;               /** 已注册的按键链表 */
-static myQueueHandle_t KeyBufQueue = NULL;      /** 按键事件队列 */
+//按键事件队列，元素类型和长度编译时确定
+MYQUEUE_STATIC_DEFINE(KeyMsgQueue, myKeyMsg_t, KEY_EVENT_MSG_QUEUE_SIZE)
+
+//按键事件订阅者
+typedef struct {
+    uint32_t ReadSeq;                           /** 下一个要读取的事件序号 */
+    uint32_t Gen;                               /** 订阅时的初始化代数，与KeyBcastGen不同表示已经被MyKey_Deinit清除 */
+    MyKeyHandle KeyID;                          /** 关心的按键，NULL表示所有按键 */
+    unsigned char EventMask;                    /** 关心的事件集合 */
+} myKeySub_t;
+
+//延迟调用的按键事件回调
+typedef struct {
+    KeyEventCallback Callback;                  /** 回调函数 */
+    myKeyMsg_t Msg;                             /** 按键消息 */
+} myKeyDeferredCall_t;
+
+//模拟按键通道
+typedef struct {
+    KeyAdcFunc Sample;                          /** ADC采样函数，NULL表示未使用 */
+    const uint16_t *Thresholds;                 /** 升序门限表 */
+    uint8_t Num;                                /** 门限个数，区间个数为Num+1 */
+    uint8_t Level;                              /** 当前所在区间 */
+    uint16_t Hysteresis;                        /** 回差 */
+    uint32_t SampleSeq;                         /** 最后一次采样时的扫描序号，保证每次扫描只采样一次 */
+} myKeyAdc_t;
+
+//按键运行统计，只由扫描写入
+typedef struct {
+    uint32_t Seq;                               /** 顺序锁，奇数表示正在修改 */
+    uint64_t PressStamp;                        /** 按下时的扫描累计时间 */
+    MyKeyStats_t Stats;                         /** 统计数据 */
+} myKeyStatsRec_t;
+
+//一次扫描的记录
+typedef struct {
+    uint64_t Start;                             /** 开始时间（ns） */
+    uint32_t Duration;                          /** 耗时（ns） */
+    uint32_t Tick;                              /** 扫描间隔（计时单位） */
+    uint16_t Visited;                           /** 逐个处理的按键数 */
+    uint16_t Callbacks;                         /** 调用的回调函数数 */
+    uint16_t Events;                            /** 产生的事件数 */
+} myKeyTraceRec_t;
+
+//按键事件输出
+typedef struct {
+    KeyEventSink Sink;                          /** 输出函数 */
+    void *Arg;                                  /** 输出函数参数 */
+    KeySinkFlushFunc Flush;                     /** 扫描结束函数，NULL表示不使用 */
+    bool Pending;                               /** 本次扫描中有事件输出，扫描结束时需要调用Flush */
+} myKeySink_t;
+
+//计时类型，以ms计时时所有计时都不会超过几秒，16位足够；以us计时时使用32位，长按计时不会缩短
+#if MYKEY_TICKS_PER_MS > 1
+typedef uint32_t myKeyTick_t;
+#else
+typedef uint16_t myKeyTick_t;
+#endif
+#define KEY_TICK_MAX                    ((myKeyTick_t)MYKEY_TICK_MAX)
+
+//按键数组长度，按32对齐，SIMD计时内核可以整块处理，需要处理的按键位图也与已分配的按键序号位图对齐
+#define KEY_LANES                       (MYKEY_SNAPSHOT_WORDS * 32)
+
+//按键配置，注册时写入，扫描时只读。按字段连续存放，按键序号即数组下标
+typedef struct {
+    KeyStatusFunc KeyStatus[KEY_LANES];         /** 按键按下的判断函数,1表示按下,初始化时指定 */
+    myKeyTick_t RepeatSpeed[KEY_LANES];         /** 连续触发周期，初始化时指定 */
+    myKeyTick_t LongPressTime[KEY_LANES];       /** 长按时间，超过该时间认为是长按，初始化时指定 */
+    uint8_t Mode[KEY_LANES];                    /** 按键支持的检测模式，初始化时指定 */
+    uint8_t CallMode[KEY_LANES];                /** 回调方式，MYKEY_CALLBACK_INLINE或者MYKEY_CALLBACK_DEFERRED */
+    KeyEventCallback Callback[KEY_LANES];       /** 按键事件回调函数，NULL表示放入按键消息队列 */
+    uint8_t Adc[KEY_LANES];                     /** 模拟按键通道序号加1，0表示使用KeyStatus读取 */
+    uint8_t AdcLevel[KEY_LANES];                /** 模拟按键对应的区间 */
+} myKeyConf_t;
+
+//按键运行状态，每次扫描都会读写
+typedef struct {
+    myKeyTick_t FilterCount[KEY_LANES];         /** 消抖滤波计时 */
+    myKeyTick_t PressTime[KEY_LANES];           /** 按键按下持续时间 */
+    myKeyTick_t RepeatCount[KEY_LANES];         /** 连续触发周期计时 */
+    myKeyTick_t DblClkCount[KEY_LANES];         /** 双击间隔时间计时 */
+    uint8_t ClickCount[KEY_LANES];              /** 连按次数计数 */
+    uint8_t Flags[KEY_LANES];                   /** 低3位为按键当前状态myKeyState_t，KEY_FLAG_PRESSED为消抖后的按键状态 */
+} myKeyHot_t;
+
+//SIMD计时内核使用的按键数据，每个按键一个通道
+typedef struct {
+    myKeyTick_t Raw[KEY_LANES];                 /** 本次扫描读到的按键状态,1表示按下 */
+    myKeyTick_t Stable[KEY_LANES];              /** 按键稳定时的按键状态，与Raw不一致就需要逐个处理，KEY_LANE_BUSY表示不稳定 */
+    myKeyTick_t PressRun[KEY_LANES];            /** 稳定时PressTime是否需要计时，KEY_LANE_ON或0 */
+    myKeyTick_t RepeatRun[KEY_LANES];           /** 稳定时RepeatCount是否需要计时 */
+    myKeyTick_t DblRun[KEY_LANES];              /** 稳定时DblClkCount是否需要计时 */
+    myKeyTick_t PressLimit[KEY_LANES];          /** 扫描开始使用该按键时复制的LongPressTime */
+    myKeyTick_t RepeatLimit[KEY_LANES];         /** 扫描开始使用该按键时复制的RepeatSpeed */
+} myKeyLane_t;
+
+#if MYKEY_USE_GESTURE
+//手势，MyKey_GestureAdd时写入
+typedef struct {
+    uint8_t Num;                                /** 步数，0表示未使用 */
+    myKeyTick_t Timeout;                        /** 相邻两步的最大间隔，0表示不限制 */
+    uint16_t Key[MYKEY_GESTURE_MAX_STEPS];      /** 每一步的按键序号 */
+    uint8_t EventMask[MYKEY_GESTURE_MAX_STEPS]; /** 每一步的事件集合 */
+} myKeyGesture_t;
+
+//手势状态机编译时的状态：每个手势已经匹配了几步，以及到达该状态时完成的所有手势
+#define KEY_GESTURE_POS_WORDS           ((MYKEY_MAX_GESTURES * (MYKEY_GESTURE_MAX_STEPS - 1) + 31) / 32)
+#define KEY_GESTURE_POS(p, k)           ((p) * (MYKEY_GESTURE_MAX_STEPS - 1) + (k) - 1)
+#define KEY_GESTURE_MAX_STATES          (4096)
+#if MYKEY_MAX_GESTURES > 32
+#error "MYKEY_MAX_GESTURES must not exceed 32"
+#endif
+typedef struct {
+    uint32_t Pos[KEY_GESTURE_POS_WORDS];        /** 第p个手势已经匹配了k步时KEY_GESTURE_POS(p, k)位置位 */
+    uint32_t Match;                             /** 完成的手势，第p位表示第p个手势 */
+} myKeyGestureSet_t;
+
+//手势状态机，事件先查表得到符号，相邻事件的间隔按门限分为TimeoutNum+1个区间，
+//状态、符号和间隔区间共同决定下一个状态。所有手势共用一个符号表，任何符号都会推进所有手势
+typedef struct {
+    uint16_t *Next;                             /** 状态转移表，[状态][符号][间隔区间]，NULL表示没有手势 */
+    uint32_t *Match;                            /** 到达该状态时完成的手势，第p位表示第p个手势 */
+    uint16_t Sym[KEY_LANES][8];                 /** 按键事件对应的符号加1，0表示不参与匹配 */
+    myKeyTick_t Timeouts[MYKEY_MAX_GESTURES];   /** 升序排列的不同间隔门限 */
+    uint8_t TimeoutNum;                         /** 间隔门限个数 */
+    uint32_t Stride;                            /** 每个状态的转移个数 */
+    uint16_t State;                             /** 当前状态 */
+    uint64_t LastTime;                          /** 上一个参与匹配的事件的扫描累计时间 */
+} myKeyGestureDfa_t;
+#endif
+
+#define KEY_LANE_ON                     (KEY_TICK_MAX)
+#define KEY_LANE_BUSY                   (KEY_TICK_MAX)
+
+#define KEY_FLAG_STATE                  (0x07U)     /** 按键当前状态 */
+#define KEY_FLAG_PRESSED                (0x08U)     /** 消抖后的按键状态,1表示按下,0表示弹起 */
+#define KEY_FLAG_RAW                    (0x10U)     /** 上一次逐个处理时读到的按键状态，用于统计抖动 */
+#define KEY_STATE(i)                    ((myKeyState_t)(KeyHot.Flags[i] & KEY_FLAG_STATE))
+#define KEY_SET_STATE(i, s)             (KeyHot.Flags[i] = (uint8_t)((KeyHot.Flags[i] & ~KEY_FLAG_STATE) | (s)))
+
+//按键句柄就是按键序号加1，保证句柄不为NULL
+#define KEY_HANDLE(i)                   ((MyKeyHandle)(uintptr_t)((i) + 1))
+#define KEY_INDEX(h)                    ((int)(uintptr_t)(h) - 1)
+
+static myKeyConf_t KeyConf;                     /** 已注册的按键配置 */
+static myKeyHot_t KeyHot;                       /** 已注册的按键运行状态 */
+static myKeyLane_t KeyLane;                     /** SIMD计时内核使用的按键数据 */
+static myKeyAdc_t KeyAdcs[MYKEY_MAX_ADCS];      /** 模拟按键通道 */
+static uint64_t KeyTime = 0;                    /** 扫描累计时间，只由扫描写入 */
+#if MYKEY_USE_GESTURE
+static myKeyGesture_t KeyGestures[MYKEY_MAX_GESTURES];  /** 已添加的手势 */
+static myKeyGestureDfa_t KeyGestureDfa;         /** 手势状态机 */
+#endif
+#if MYKEY_USE_STATS
+static myKeyStatsRec_t KeyStats[KEY_LANES];     /** 按键运行统计 */
+#endif
+#if MYKEY_USE_TRACE
+static myKeyTraceRec_t KeyTraceRing[MYKEY_TRACE_NUM];   /** 扫描记录缓冲区 */
+static uint32_t KeyTraceNum = 0;                /** 已写入扫描记录缓冲区的记录总数，只由扫描写入 */
+static KeyTraceClockFunc KeyTraceClock = NULL;  /** 扫描记录时钟，NULL表示不记录 */
+static KeyTraceClockFunc KeyTraceScanClock = NULL;  /** 本次扫描使用的时钟 */
+static myKeyTraceRec_t KeyTraceCur;             /** 本次扫描的记录 */
+#define KEY_TRACE_INC(Field)            (KeyTraceCur.Field++)
+#else
+#define KEY_TRACE_INC(Field)
+#endif
+static KeyMsgQueue_t KeyBufQueue;               /** 按键事件队列 */
 static volatile int MyKeyLock = 0;              /** TODO: 保护锁,无操作系统环境下需要实现 */
+static myKeyMsg_t KeyBcastRing[KEY_EVENT_BCAST_SIZE];   /** 按键事件广播缓冲区 */
+static uint32_t KeyBcastSeq = 0;                /** 已写入广播缓冲区的事件总数，只由扫描写入 */
+static size_t KeyBcastSubNum = 0;               /** 订阅者个数，没有订阅者时不写广播缓冲区 */
+static uint32_t KeyBcastGen = 0;                /** 初始化代数，每次MyKey_Deinit加1，之前的订阅全部失效 */
+static myKeySink_t KeySinks[KEY_EVENT_SINK_NUM];    /** 按键事件输出函数 */
+static size_t KeySinkNum = 0;                   /** 按键事件输出函数个数 */
+static myKeyDeferredCall_t KeyDeferredCalls[KEY_DEFERRED_CALL_NUM]; /** 本次扫描缓存的延迟回调 */
+static size_t KeyDeferredCallNum = 0;           /** 已缓存的延迟回调个数 */
+static uint32_t KeyIndexUsed[MYKEY_SNAPSHOT_WORDS];     /** 已发布的按键，扫描只处理这些按键 */
+static uint32_t KeyIndexClaimed[MYKEY_SNAPSHOT_WORDS];  /** 已占用的按键序号，包括正在注册和等待回收的 */
+static uint32_t KeyIndexNew[MYKEY_SNAPSHOT_WORDS];      /** 新注册的按键，扫描时初始化运行状态后清除 */
+static uint32_t KeyIndexRetired[MYKEY_SNAPSHOT_WORDS];  /** 已注销等待回收的按键序号 */
+static uint32_t KeyIndexKnown[MYKEY_SNAPSHOT_WORDS];    /** 上一次扫描时已发布的按键，只由扫描访问 */
+static uint32_t KeyIndexActive[MYKEY_SNAPSHOT_WORDS];   /** 没有稳定在松开状态或者有计时器在运行的按键，只由扫描访问 */
+static KeyProbeFunc KeyProbe = NULL;            /** 按键总探测函数 */
+static uint32_t KeyInputLevel[MYKEY_SNAPSHOT_WORDS];    /** 输入按键的状态，由MyKey_SetInput写入，1表示按下 */
+static uint32_t KeyRetireSeq[KEY_LANES];        /** 注销时的扫描序号，最高位KEY_RETIRED表示等待回收 */
+static uint32_t KeyScanSeq = 0;                 /** 扫描序号，奇数表示正在扫描 */
+static uint32_t KeyStateBits[MYKEY_SNAPSHOT_WORDS]; /** 已发布的消抖后的按键状态位图 */
+static uint32_t KeyStateNext[MYKEY_SNAPSHOT_WORDS]; /** 本次扫描修改中的按键状态位图，只由扫描访问 */
+static uint32_t KeyStateSeq = 0;                /** 按键状态位图顺序锁，奇数表示正在修改 */
+static bool KeyStateDirty = false;              /** 本次扫描是否修改了按键状态 */
+
+#define KEY_RETIRED                     (0x80000000UL)
 
-static bool KeyList_Put(myKey_t **ListHead, MyKeyHandle KeyID)
+//回收没有扫描在使用的按键序号：注销时没有在扫描，或者注销时的那次扫描已经结束
+static void KeyIndex_Reclaim(void)
 {
-    myKey_t *p = NULL;
-    myKey_t *q = NULL;
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        uint32_t retired = __atomic_load_n(&KeyIndexRetired[w], __ATOMIC_ACQUIRE);
+        while (retired) {
+            int i = w * 32 + __builtin_ctz(retired);
+            uint32_t bit = 1UL << (i % 32);
+            retired &= retired - 1;
+            uint32_t retire = __atomic_load_n(&KeyRetireSeq[i], __ATOMIC_ACQUIRE);
+            if (!(retire & KEY_RETIRED)) {
+                continue;
+            }
+            //扫描序号必须在注销记录之后读取，否则注销记录可能比读到的扫描序号新，不相等并不说明那次扫描已经结束
+            uint32_t seq = __atomic_load_n(&KeyScanSeq, __ATOMIC_ACQUIRE);
+            if (!(retire & 1) || ((retire ^ seq) & ~KEY_RETIRED)) {
+                //与其它注册者竞争回收，只有一个能成功
+                if (__atomic_compare_exchange_n(&KeyRetireSeq[i], &retire, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                    __atomic_fetch_and(&KeyIndexRetired[w], ~bit, __ATOMIC_RELAXED);
+                    __atomic_fetch_and(&KeyIndexClaimed[w], ~bit, __ATOMIC_RELEASE);
+                }
+            }
+        }
+    }
+}
 
-    if (KeyID == NULL) {
-        return false;
+static int KeyIndex_Alloc(void)
+{
+    KeyIndex_Reclaim();
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        uint32_t claimed = __atomic_load_n(&KeyIndexClaimed[w], __ATOMIC_ACQUIRE);
+        while (~claimed) {
+            int index = w * 32 + __builtin_ctz(~claimed);
+            if (index >= MYKEY_MAX_KEYS) {
+                return -1;
+            }
+            //与其它注册者竞争同一个序号，失败时claimed被更新为最新值
+            if (__atomic_compare_exchange_n(&KeyIndexClaimed[w], &claimed, claimed | (1UL << (index % 32)),
+                                            false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                return index;
+            }
+        }
     }
+    return -1;
+}
 
-    if (*ListHead == NULL) {        //链表为空
-        p = (myKey_t *)KeyID;
-        p->KeyID = KeyID;
-        p->Next_Key = NULL;
-        *ListHead = p;
-        return true;
+//配置写完之后发布，下一次扫描开始处理该按键
+static void KeyIndex_Publish(int Index)
+{
+    uint32_t bit = 1UL << (Index % 32);
+    __atomic_fetch_or(&KeyIndexNew[Index / 32], bit, __ATOMIC_RELEASE);
+    __atomic_fetch_or(&KeyIndexUsed[Index / 32], bit, __ATOMIC_RELEASE);
+}
+
+//修改本次扫描的按键状态位图，扫描结束时由KeyState_Commit统一发布
+static void KeyState_Set(int Index, int State)
+{
+    uint32_t bit = 1UL << (Index % 32);
+
+    KeyStateNext[Index / 32] = State ? (KeyStateNext[Index / 32] | bit) : (KeyStateNext[Index / 32] & ~bit);
+    KeyStateDirty = true;
+}
+
+//顺序锁只在复制位图时为奇数，不包含任何用户代码，回调函数中调用MyKey_Snapshot不会死等
+static void KeyState_Commit(void)
+{
+    if (!KeyStateDirty) {
+        return;
+    }
+    KeyStateDirty = false;
+    __atomic_store_n(&KeyStateSeq, KeyStateSeq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        __atomic_store_n(&KeyStateBits[w], KeyStateNext[w], __ATOMIC_RELAXED);
     }
+    __atomic_store_n(&KeyStateSeq, KeyStateSeq + 1, __ATOMIC_RELEASE);
+}
 
-    q = *ListHead;
-    p = (*ListHead)->Next_Key;
-    while (p != NULL) {
-        if (q->KeyID == KeyID) {            //链表中已经存在
-            return true;
+#if MYKEY_USE_STATS
+static void KeyStats_Begin(int i)
+{
+    __atomic_store_n(&KeyStats[i].Seq, KeyStats[i].Seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void KeyStats_End(int i)
+{
+    __atomic_store_n(&KeyStats[i].Seq, KeyStats[i].Seq + 1, __ATOMIC_RELEASE);
+}
+
+//记录按住时间，32ms以下为第0项，之后每项时间加倍
+static void KeyStats_Hold(int i)
+{
+    uint64_t hold = (KeyTime - KeyStats[i].PressStamp) / MYKEY_TICKS_PER_MS / 32;
+    int n = hold ? (64 - __builtin_clzll(hold)) : 0;
+    if (n >= MYKEY_HOLD_HIST_NUM) {
+        n = MYKEY_HOLD_HIST_NUM - 1;
+    }
+    KeyStats_Begin(i);
+    KeyStats[i].Stats.HoldHist[n]++;
+    KeyStats_End(i);
+}
+
+#define KEY_STATS_INC(i, Field)         do { KeyStats_Begin(i); KeyStats[i].Stats.Field++; KeyStats_End(i); } while (0)
+#else
+#define KEY_STATS_INC(i, Field)
+#endif
+
+#if MYKEY_USE_TRACE
+static void KeyTrace_Begin(myKeyTick_t InterVal)
+{
+    KeyTraceScanClock = __atomic_load_n(&KeyTraceClock, __ATOMIC_ACQUIRE);
+    if (KeyTraceScanClock) {
+        memset(&KeyTraceCur, 0, sizeof(KeyTraceCur));
+        KeyTraceCur.Tick = InterVal;
+        KeyTraceCur.Start = KeyTraceScanClock();
+    }
+}
+
+static void KeyTrace_End(void)
+{
+    if (KeyTraceScanClock) {
+        uint64_t duration = KeyTraceScanClock() - KeyTraceCur.Start;
+        KeyTraceCur.Duration = (duration > UINT32_MAX) ? UINT32_MAX : (uint32_t)duration;
+        myQueueLappedPut(KeyTraceRing, MYKEY_TRACE_NUM, sizeof(myKeyTraceRec_t), &KeyTraceNum, &KeyTraceCur);
+    }
+}
+#endif
+
+static inline myKeyTick_t KeyTick_Add(myKeyTick_t a, myKeyTick_t b)
+{
+    return (a > KEY_TICK_MAX - b) ? KEY_TICK_MAX : (myKeyTick_t)(a + b);
+}
+
+static bool KeyIndex_Valid(MyKeyHandle Key)
+{
+    int i = KEY_INDEX(Key);
+    return (i >= 0) && (i < MYKEY_MAX_KEYS) && (__atomic_load_n(&KeyIndexUsed[i / 32], __ATOMIC_ACQUIRE) & (1UL << (i % 32)));
+}
+
+//根据按键当前状态计算下一次扫描时计时内核需要做的事情，每次逐个处理按键之后调用
+static void KeyLane_Update(int i)
+{
+    uint8_t mode = KeyConf.Mode[i];
+    myKeyState_t state = KEY_STATE(i);
+
+    KeyLane.PressRun[i] = 0;
+    KeyLane.RepeatRun[i] = 0;
+    KeyLane.DblRun[i] = 0;
+    if ((KeyHot.Flags[i] & KEY_FLAG_PRESSED) && KeyHot.FilterCount[i] >= (KEY_FILTER_TIME + KEY_FILTER_TIME)) {
+        //持续按住，只有长按和连续触发计时
+        KeyLane.Stable[i] = 1;
+        if ((mode & MYKEY_EVENT_LONG_PRESS) && KeyHot.PressTime[i] < KeyConf.LongPressTime[i]) {
+            KeyLane.PressRun[i] = KEY_LANE_ON;
+        } else if (mode & MYKEY_EVENT_REPEAT) {
+            //同时使能长按和连续触发时，长按时间到达之后开始连续触发计时
+            KeyLane.RepeatRun[i] = KEY_LANE_ON;
+        }
+    } else if (!(KeyHot.Flags[i] & KEY_FLAG_PRESSED) && KeyHot.FilterCount[i] == 0
+               && (state == KEYSTATE_RELASE || state == KEYSTATE_PRESS_SD || state == KEYSTATE_PRESS_D)) {
+        //已经松开，只有双击等待计时
+        KeyLane.Stable[i] = 0;
+        if (state != KEYSTATE_RELASE) {
+            KeyLane.DblRun[i] = KEY_LANE_ON;
         }
-        q = p;
-        p = p->Next_Key;
+    } else {
+        KeyLane.Stable[i] = KEY_LANE_BUSY;
+    }
+    if (KeyLane.Stable[i] == 0 && KeyLane.DblRun[i] == 0) {
+        KeyIndexActive[i / 32] &= ~(1UL << (i % 32));
+    } else {
+        KeyIndexActive[i / 32] |= 1UL << (i % 32);
     }
+}
 
-    //链表中不存在，链接进去
-    p = (myKey_t *)KeyID;
-    //初始化节点数据
-    p->KeyID = KeyID;
-    p->Next_Key = NULL;
-    //加入链表
-    q->Next_Key = p;
-    return true;
+//初始化按键运行状态，只在扫描中调用，注册和注销不直接修改运行状态，避免与计时内核的整块写回冲突
+static void KeyHot_Reset(int i)
+{
+    if (KeyHot.Flags[i] & KEY_FLAG_PRESSED) {
+        KeyState_Set(i, 0);
+    }
+    KeyHot.FilterCount[i] = 0;
+    KeyHot.PressTime[i] = 0;
+    KeyHot.RepeatCount[i] = 0;
+    KeyHot.DblClkCount[i] = 0;
+    KeyHot.ClickCount[i] = 0;
+    KeyHot.Flags[i] = KEYSTATE_RELASE;
+    KeyLane.Raw[i] = 0;
+    KeyLane.Stable[i] = 0;
+    KeyLane.PressRun[i] = 0;
+    KeyLane.RepeatRun[i] = 0;
+    KeyLane.DblRun[i] = 0;
+    KeyLane.PressLimit[i] = 0;
+    KeyLane.RepeatLimit[i] = 0;
+    KeyIndexActive[i / 32] &= ~(1UL << (i % 32));
+#if MYKEY_USE_STATS
+    KeyStats_Begin(i);
+    memset(&KeyStats[i].Stats, 0, sizeof(KeyStats[i].Stats));
+    KeyStats_End(i);
+#endif
 }
 
+//所有按键都稳定在松开状态并且没有计时器在运行
+static bool KeyIndex_Idle(const uint32_t *Used)
+{
+    uint32_t active = 0;
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        active |= KeyIndexActive[w] & Used[w];
+    }
+    return active == 0;
+}
 
-int MyKey_Init(void)
+//是否有按下的输入按键，输入按键不经过探测函数
+static bool KeyInput_Any(const uint32_t *Used)
 {
-    KeyBufQueue = myQueueCreate(KEY_EVENT_MSG_QUEUE_SIZE, sizeof(myKeyMsg_t));
-    if (KeyBufQueue) {
-        printf("Key message queue create success, queue len %d\r\n", KEY_EVENT_MSG_QUEUE_SIZE);
-        return 0;
+    uint32_t level = 0;
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        level |= __atomic_load_n(&KeyInputLevel[w], __ATOMIC_RELAXED) & Used[w];
+    }
+    return level != 0;
+}
+
+//扫描开始时同步已发布的按键：新注册的和上次扫描之后注销的按键都初始化运行状态，
+//本次扫描开始使用的按键把计时门限复制到通道中。计时内核整块读取通道，
+//不能直接读取KeyConf，否则会读到其它线程正在注册的按键配置
+static void KeySet_Sync(const uint32_t *Used)
+{
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        uint32_t fresh = __atomic_exchange_n(&KeyIndexNew[w], 0, __ATOMIC_ACQ_REL);
+        uint32_t changed = (KeyIndexKnown[w] & ~Used[w]) | fresh;
+        uint32_t load = (Used[w] & ~KeyIndexKnown[w]) | (fresh & Used[w]);
+        while (changed) {
+            KeyHot_Reset(w * 32 + __builtin_ctz(changed));
+            changed &= changed - 1;
+        }
+        //Used中的按键配置已经发布，并且在本次扫描结束之前不会被回收
+        while (load) {
+            int i = w * 32 + __builtin_ctz(load);
+            KeyLane.PressLimit[i] = KeyConf.LongPressTime[i];
+            KeyLane.RepeatLimit[i] = KeyConf.RepeatSpeed[i];
+            load &= load - 1;
+        }
+        KeyIndexKnown[w] = Used[w];
     }
-    printf("Key message queue create failed\r\n");
-    return -1;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#if defined(__AVX2__)
+typedef __m256i keyVec_t;
+#define KEY_V_LOAD(p)                   _mm256_loadu_si256((const __m256i *)(p))
+#define KEY_V_STORE(p, v)               _mm256_storeu_si256((__m256i *)(p), (v))
+#define KEY_V_ZERO()                    _mm256_setzero_si256()
+#define KEY_V_AND(a, b)                 _mm256_and_si256((a), (b))
+#define KEY_V_ANDNOT(a, b)              _mm256_andnot_si256((a), (b))
+#define KEY_V_OR(a, b)                  _mm256_or_si256((a), (b))
+#define KEY_V_XOR(a, b)                 _mm256_xor_si256((a), (b))
+#if MYKEY_TICKS_PER_MS > 1
+#define KEY_SIMD_WIDTH                  (8)
+#define KEY_V_SET1(x)                   _mm256_set1_epi32((int)(x))
+#define KEY_V_CMPEQ(a, b)               _mm256_cmpeq_epi32((a), (b))
+#define KEY_V_CMPGT(a, b)               _mm256_cmpgt_epi32((a), (b))
+#define KEY_V_ADD(a, b)                 _mm256_add_epi32((a), (b))
+#define KEY_V_MASK(v)                   ((uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(v)))
+#else
+#define KEY_SIMD_WIDTH                  (16)
+#define KEY_V_SET1(x)                   _mm256_set1_epi16((short)(x))
+#define KEY_V_CMPEQ(a, b)               _mm256_cmpeq_epi16((a), (b))
+#define KEY_V_ADDS(a, b)                _mm256_adds_epu16((a), (b))
+#define KEY_V_SUBS(a, b)                _mm256_subs_epu16((a), (b))
+//packs在每个128位内打包，低8位和第16~23位分别是前8个和后8个按键
+#define KEY_V_MASK(v)                   ({uint32_t _m = (uint32_t)_mm256_movemask_epi8(_mm256_packs_epi16((v), _mm256_setzero_si256())); \
+                                          (_m & 0xFFU) | ((_m >> 8) & 0xFF00U);})
+#endif
+#else
+typedef __m128i keyVec_t;
+#define KEY_V_LOAD(p)                   _mm_loadu_si128((const __m128i *)(p))
+#define KEY_V_STORE(p, v)               _mm_storeu_si128((__m128i *)(p), (v))
+#define KEY_V_ZERO()                    _mm_setzero_si128()
+#define KEY_V_AND(a, b)                 _mm_and_si128((a), (b))
+#define KEY_V_ANDNOT(a, b)              _mm_andnot_si128((a), (b))
+#define KEY_V_OR(a, b)                  _mm_or_si128((a), (b))
+#define KEY_V_XOR(a, b)                 _mm_xor_si128((a), (b))
+#if MYKEY_TICKS_PER_MS > 1
+#define KEY_SIMD_WIDTH                  (4)
+#define KEY_V_SET1(x)                   _mm_set1_epi32((int)(x))
+#define KEY_V_CMPEQ(a, b)               _mm_cmpeq_epi32((a), (b))
+#define KEY_V_CMPGT(a, b)               _mm_cmpgt_epi32((a), (b))
+#define KEY_V_ADD(a, b)                 _mm_add_epi32((a), (b))
+#define KEY_V_MASK(v)                   ((uint32_t)_mm_movemask_ps(_mm_castsi128_ps(v)))
+#else
+#define KEY_SIMD_WIDTH                  (8)
+#define KEY_V_SET1(x)                   _mm_set1_epi16((short)(x))
+#define KEY_V_CMPEQ(a, b)               _mm_cmpeq_epi16((a), (b))
+#define KEY_V_ADDS(a, b)                _mm_adds_epu16((a), (b))
+#define KEY_V_SUBS(a, b)                _mm_subs_epu16((a), (b))
+#define KEY_V_MASK(v)                   ((uint32_t)_mm_movemask_epi8(_mm_packs_epi16((v), _mm_setzero_si128())))
+#endif
+#endif
+
+#if MYKEY_TICKS_PER_MS > 1
+//32位没有无符号饱和加法和无符号比较，翻转符号位之后用有符号比较，和小于加数说明溢出
+#define KEY_V_SIGN()                    KEY_V_SET1(0x80000000UL)
+#define KEY_V_GTU(a, b)                 KEY_V_CMPGT(KEY_V_XOR((a), KEY_V_SIGN()), KEY_V_XOR((b), KEY_V_SIGN()))
+#define KEY_V_ADDS(a, b)                ({keyVec_t _s = KEY_V_ADD((a), (b)); KEY_V_OR(_s, KEY_V_GTU((a), _s));})
+#define KEY_V_GE(a, b)                  KEY_V_XOR(KEY_V_GTU((b), (a)), KEY_V_CMPEQ(KEY_V_ZERO(), KEY_V_ZERO()))
+#else
+#define KEY_V_GE(a, b)                  KEY_V_CMPEQ(KEY_V_SUBS((b), (a)), KEY_V_ZERO())
+#endif
+
+//计时器加上间隔（不计时的通道加0），到达门限的通道标记为需要处理；不需要处理的通道写回新的计时值
+#define KEY_V_TIMER(Timer, Run, Limit)  do { \
+        keyVec_t _t = KEY_V_LOAD(&(Timer)[i]); \
+        keyVec_t _run = KEY_V_LOAD(&(Run)[i]); \
+        keyVec_t _tn = KEY_V_ADDS(_t, KEY_V_AND(dt, _run)); \
+        att = KEY_V_OR(att, KEY_V_AND(_run, KEY_V_GE(_tn, (Limit)))); \
+        t[n] = _t; tn[n] = _tn; n++; \
+    } while (0)
+
+/**
+ * @brief 一次处理KEY_SIMD_WIDTH个按键：稳定的按键只推进计时，
+ *        按键状态与稳定状态不一致或者计时到达门限的按键在Attention中置位，由KeyScan_One逐个处理
+ */
+static void KeyTimer_Advance(myKeyTick_t InterVal, const uint32_t *Used, uint32_t *Attention)
+{
+    (void)Used;
+    const keyVec_t dt = KEY_V_SET1(InterVal);
+    const keyVec_t dbl = KEY_V_SET1(KEY_DBL_INTERVAL);
+    const keyVec_t zero = KEY_V_ZERO();
+    const keyVec_t ones = KEY_V_CMPEQ(zero, zero);
+
+    for (int i = 0; i < KEY_LANES; i += KEY_SIMD_WIDTH) {
+        keyVec_t t[3], tn[3];
+        int n = 0;
+        keyVec_t att = KEY_V_XOR(KEY_V_CMPEQ(KEY_V_LOAD(&KeyLane.Raw[i]), KEY_V_LOAD(&KeyLane.Stable[i])), ones);
+        KEY_V_TIMER(KeyHot.PressTime, KeyLane.PressRun, KEY_V_LOAD(&KeyLane.PressLimit[i]));
+        KEY_V_TIMER(KeyHot.RepeatCount, KeyLane.RepeatRun, KEY_V_LOAD(&KeyLane.RepeatLimit[i]));
+        KEY_V_TIMER(KeyHot.DblClkCount, KeyLane.DblRun, dbl);
+        //需要逐个处理的按键保持原来的计时值
+        KEY_V_STORE(&KeyHot.PressTime[i], KEY_V_OR(KEY_V_AND(att, t[0]), KEY_V_ANDNOT(att, tn[0])));
+        KEY_V_STORE(&KeyHot.RepeatCount[i], KEY_V_OR(KEY_V_AND(att, t[1]), KEY_V_ANDNOT(att, tn[1])));
+        KEY_V_STORE(&KeyHot.DblClkCount[i], KEY_V_OR(KEY_V_AND(att, t[2]), KEY_V_ANDNOT(att, tn[2])));
+        Attention[i / 32] |= KEY_V_MASK(att) << (i % 32);
+    }
+}
+#else
+//没有SIMD时只处理已注册的按键
+static void KeyTimer_Advance(myKeyTick_t InterVal, const uint32_t *Used, uint32_t *Attention)
+{
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        uint32_t used = Used[w];
+        while (used) {
+            int i = w * 32 + __builtin_ctz(used);
+            used &= used - 1;
+            if (KeyLane.Raw[i] != KeyLane.Stable[i]) {
+                Attention[w] |= 1UL << (i % 32);
+                continue;
+            }
+            //KeyLane_Update保证同一时间最多只有一个计时器在计时
+            if (KeyLane.PressRun[i]) {
+                myKeyTick_t press = KeyTick_Add(KeyHot.PressTime[i], InterVal);
+                if (press >= KeyLane.PressLimit[i]) {
+                    Attention[w] |= 1UL << (i % 32);
+                } else {
+                    KeyHot.PressTime[i] = press;
+                }
+            } else if (KeyLane.RepeatRun[i]) {
+                myKeyTick_t repeat = KeyTick_Add(KeyHot.RepeatCount[i], InterVal);
+                if (repeat >= KeyLane.RepeatLimit[i]) {
+                    Attention[w] |= 1UL << (i % 32);
+                } else {
+                    KeyHot.RepeatCount[i] = repeat;
+                }
+            } else if (KeyLane.DblRun[i]) {
+                myKeyTick_t dbl = KeyTick_Add(KeyHot.DblClkCount[i], InterVal);
+                if (dbl >= KEY_DBL_INTERVAL) {
+                    Attention[w] |= 1UL << (i % 32);
+                } else {
+                    KeyHot.DblClkCount[i] = dbl;
+                }
+            }
+        }
+    }
+}
+#endif
+
+//二分查找采样值所在区间，当前区间加上回差范围内保持不变
+static uint8_t KeyAdc_Decode(const myKeyAdc_t *Adc, int Value)
+{
+    const uint16_t *t = Adc->Thresholds;
+    uint8_t cur = Adc->Level;
+    uint8_t lo = 0, hi = Adc->Num;
+
+    if ((cur == 0 || Value >= (int)t[cur - 1] - (int)Adc->Hysteresis)
+            && (cur == Adc->Num || Value < (int)t[cur] + (int)Adc->Hysteresis)) {
+        return cur;
+    }
+    //找第一个大于采样值的门限
+    while (lo < hi) {
+        uint8_t mid = (uint8_t)((lo + hi) / 2);
+        if (Value < (int)t[mid]) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+static int KeyAdc_Level(int Index)
+{
+    myKeyAdc_t *adc = &KeyAdcs[Index];
+    if (adc->SampleSeq != KeyScanSeq) {
+        adc->SampleSeq = KeyScanSeq;
+        adc->Level = KeyAdc_Decode(adc, adc->Sample());
+    }
+    return adc->Level;
+}
+
+int MyKey_Init(void)
+{
+    KeyMsgQueueInit(&KeyBufQueue);
+    printf("Key message queue ready, queue len %d\r\n", KEY_EVENT_MSG_QUEUE_SIZE);
+    return 0;
 }
 
 int MyKey_Deinit(void)
 {
-    myQueueDelete(KeyBufQueue);
-    myKey_t *p;
-    while (MyKeyList) {
-        p = MyKeyList;
-        MyKeyList = MyKeyList->Next_Key;
-        free(p);
+    KeyMsgQueueInit(&KeyBufQueue);
+    memset(KeyIndexUsed, 0, sizeof(KeyIndexUsed));
+    memset(KeyIndexClaimed, 0, sizeof(KeyIndexClaimed));
+    memset(KeyIndexNew, 0, sizeof(KeyIndexNew));
+    memset(KeyIndexRetired, 0, sizeof(KeyIndexRetired));
+    memset(KeyIndexKnown, 0, sizeof(KeyIndexKnown));
+    memset(KeyIndexActive, 0, sizeof(KeyIndexActive));
+    KeyProbe = NULL;
+    //清除所有订阅和输出函数，之前的订阅句柄只能用MyKey_Unsubscribe释放
+    __atomic_fetch_add(&KeyBcastGen, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&KeyBcastSubNum, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&KeyBcastSeq, 0, __ATOMIC_RELEASE);
+    memset(KeyBcastRing, 0, sizeof(KeyBcastRing));
+    memset(KeySinks, 0, sizeof(KeySinks));
+    KeySinkNum = 0;
+    memset(KeyInputLevel, 0, sizeof(KeyInputLevel));
+    memset(KeyStateBits, 0, sizeof(KeyStateBits));
+    memset(KeyStateNext, 0, sizeof(KeyStateNext));
+    KeyStateDirty = false;
+    memset(&KeyHot, 0, sizeof(KeyHot));
+    memset(&KeyLane, 0, sizeof(KeyLane));
+    memset(KeyAdcs, 0, sizeof(KeyAdcs));
+    KeyTime = 0;
+    MyKey_GestureClear();
+#if MYKEY_USE_STATS
+    memset(KeyStats, 0, sizeof(KeyStats));
+#endif
+#if MYKEY_USE_TRACE
+    memset(KeyTraceRing, 0, sizeof(KeyTraceRing));
+    KeyTraceNum = 0;
+    KeyTraceClock = NULL;
+#endif
+    return 0;
+}
+
+static void KeyBcast_Put(const myKeyMsg_t *Msg)
+{
+    myQueueLappedPut(KeyBcastRing, KEY_EVENT_BCAST_SIZE, sizeof(myKeyMsg_t), &KeyBcastSeq, Msg);
+}
+
+static void KeyDeferred_Flush(void)
+{
+    //回调中可能再产生延迟回调，先取出当前个数
+    size_t num = KeyDeferredCallNum;
+    KeyDeferredCallNum = 0;
+    for (size_t n = 0; n < num; n++) {
+        myKeyDeferredCall_t *call = &KeyDeferredCalls[n];
+        KEY_TRACE_INC(Callbacks);
+        call->Callback(call->Msg.KeyID, call->Msg.KeyEvent, call->Msg.KeyClickCount);
     }
 }
 
-static bool KeyMessage_Put(MyKeyHandle KeyID, unsigned char KeyEvent, unsigned char ClickCount)
+static bool KeyMessage_Deliver(int Index, unsigned char KeyEvent, unsigned char ClickCount)
 {
+    KeyEventCallback callback = __atomic_load_n(&KeyConf.Callback[Index], __ATOMIC_ACQUIRE);
     myKeyMsg_t temp;
-    temp.KeyID = KeyID;
+    temp.KeyID = KEY_HANDLE(Index);
     temp.KeyEvent = KeyEvent;
     temp.KeyClickCount = ClickCount;
-    return myQueuePut(KeyBufQueue, &temp, 1);
+    KEY_TRACE_INC(Events);
+    if (__atomic_load_n(&KeyBcastSubNum, __ATOMIC_RELAXED)) {
+        KeyBcast_Put(&temp);
+    }
+    for (size_t i = 0; i < KeySinkNum; i++) {
+        KeySinks[i].Sink(temp.KeyID, KeyEvent, ClickCount, KeySinks[i].Arg);
+        KeySinks[i].Pending = true;
+    }
+    if (callback == NULL) {
+        if (!KeyMsgQueuePut(&KeyBufQueue, &temp)) {
+            KEY_STATS_INC(Index, Dropped);
+            return false;
+        }
+        return true;
+    }
+    if (KeyConf.CallMode[Index] == MYKEY_CALLBACK_DEFERRED) {
+        if (KeyDeferredCallNum >= KEY_DEFERRED_CALL_NUM) {
+            KeyDeferred_Flush();
+        }
+        KeyDeferredCalls[KeyDeferredCallNum].Callback = callback;
+        KeyDeferredCalls[KeyDeferredCallNum].Msg = temp;
+        KeyDeferredCallNum++;
+    } else {
+        KEY_TRACE_INC(Callbacks);
+        callback(temp.KeyID, KeyEvent, ClickCount);
+    }
+    return true;
+}
+
+#if MYKEY_USE_GESTURE
+//手势状态机前进一步，返回完成的手势集合
+static uint32_t KeyGesture_Step(int Index, unsigned char KeyEvent)
+{
+    myKeyGestureDfa_t *dfa = &KeyGestureDfa;
+    if (dfa->Next == NULL || KeyEvent == 0 || KeyEvent >= MYKEY_EVENT_GESTURE) {
+        return 0;
+    }
+    uint16_t sym = dfa->Sym[Index][__builtin_ctz(KeyEvent)];
+    if (sym == 0) {
+        return 0;
+    }
+    uint64_t gap = KeyTime - dfa->LastTime;
+    uint32_t cls = 0, end = dfa->TimeoutNum;
+    dfa->LastTime = KeyTime;
+    //间隔区间为小于gap的门限个数，门限升序排列，二分查找
+    while (cls < end) {
+        uint32_t mid = (cls + end) / 2;
+        if (gap > dfa->Timeouts[mid]) {
+            cls = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    dfa->State = dfa->Next[dfa->State * dfa->Stride + (sym - 1) * (dfa->TimeoutNum + 1U) + cls];
+    return dfa->Match[dfa->State];
+}
+#endif
+
+static bool KeyMessage_Put(int Index, unsigned char KeyEvent, unsigned char ClickCount)
+{
+#if MYKEY_USE_GESTURE
+    uint32_t match = KeyGesture_Step(Index, KeyEvent);
+    bool ret = KeyMessage_Deliver(Index, KeyEvent, ClickCount);
+    //手势事件在触发它的事件之后输出，同时完成多个手势时按序号从小到大输出
+    for (; match; match &= match - 1) {
+        KeyMessage_Deliver(Index, MYKEY_EVENT_GESTURE, (unsigned char)__builtin_ctz(match));
+    }
+    return ret;
+#else
+    return KeyMessage_Deliver(Index, KeyEvent, ClickCount);
+#endif
 }
 
 int MyKey_Read(MyKeyHandle *KeyID, unsigned char *KeyEvent, unsigned char *KeyClickCount)
 {
     myKeyMsg_t temp;
-    if ( myQueueGet(KeyBufQueue, &temp, 1)) {
+    if (KeyMsgQueueGet(&KeyBufQueue, &temp)) {
         *KeyID = temp.KeyID;
         *KeyEvent = temp.KeyEvent;
         *KeyClickCount = temp.KeyClickCount;
@@ -139,287 +815,1003 @@ int MyKey_Read(MyKeyHandle *KeyID, unsigned char *KeyEvent, unsigned char *KeyCl
     return -1;
 }
 
-int MyKey_Register(MyKeyHandle *Key, KeyStatusFunc func, unsigned char Mode, size_t RepeatSpeed, size_t LongPressTime)
+int MyKey_Subscribe(MyKeySubHandle *Sub, MyKeyHandle KeyID, unsigned char EventMask)
 {
-    //先检查按键是否已经被注册过了
-    myKey_t *p = MyKeyList;
-    while (p != NULL) {
-        if (p->KeyStatus == func) {
+    if (Sub == NULL) {
+        return -1;
+    }
+    myKeySub_t *NewSub = (myKeySub_t *)malloc(sizeof(myKeySub_t));
+    if (NewSub == NULL) {
+        return -1;
+    }
+    NewSub->ReadSeq = __atomic_load_n(&KeyBcastSeq, __ATOMIC_ACQUIRE);
+    NewSub->KeyID = KeyID;
+    NewSub->EventMask = EventMask;
+    NewSub->Gen = __atomic_load_n(&KeyBcastGen, __ATOMIC_ACQUIRE);
+    //多个任务可能同时订阅和取消订阅
+    __atomic_fetch_add(&KeyBcastSubNum, 1, __ATOMIC_RELAXED);
+    *Sub = (MyKeySubHandle)NewSub;
+    return 0;
+}
+
+int MyKey_Unsubscribe(MyKeySubHandle *Sub)
+{
+    if (Sub == NULL || *Sub == NULL) {
+        return -1;
+    }
+    //MyKey_Deinit之前的订阅已经不计数了
+    if (((myKeySub_t *)*Sub)->Gen == __atomic_load_n(&KeyBcastGen, __ATOMIC_ACQUIRE)) {
+        __atomic_fetch_sub(&KeyBcastSubNum, 1, __ATOMIC_RELAXED);
+    }
+    free(*Sub);
+    *Sub = NULL;
+    return 0;
+}
+
+int MyKey_SubRead(MyKeySubHandle Sub, MyKeyHandle *KeyID, unsigned char *KeyEvent, unsigned char *KeyClickCount)
+{
+    myKeySub_t *p = (myKeySub_t *)Sub;
+    myKeyMsg_t temp;
+
+    if (p == NULL || p->Gen != __atomic_load_n(&KeyBcastGen, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+    while (myQueueLappedGet(KeyBcastRing, KEY_EVENT_BCAST_SIZE, sizeof(myKeyMsg_t), &KeyBcastSeq, &p->ReadSeq, &temp)) {
+        if ((p->KeyID == NULL || p->KeyID == temp.KeyID) && (p->EventMask & temp.KeyEvent)) {
+            *KeyID = temp.KeyID;
+            *KeyEvent = temp.KeyEvent;
+            *KeyClickCount = temp.KeyClickCount;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int MyKey_AddSink(KeyEventSink Sink, void *Arg)
+{
+    if (Sink == NULL || KeySinkNum >= KEY_EVENT_SINK_NUM) {
+        return -1;
+    }
+    KeySinks[KeySinkNum].Sink = Sink;
+    KeySinks[KeySinkNum].Arg = Arg;
+    KeySinks[KeySinkNum].Flush = NULL;
+    KeySinks[KeySinkNum].Pending = false;
+    KeySinkNum++;
+    return 0;
+}
+
+int MyKey_RemoveSink(KeyEventSink Sink, void *Arg)
+{
+    for (size_t i = 0; i < KeySinkNum; i++) {
+        if (KeySinks[i].Sink == Sink && KeySinks[i].Arg == Arg) {
+            KeySinkNum--;
+            KeySinks[i] = KeySinks[KeySinkNum];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int MyKey_SetSinkFlush(KeyEventSink Sink, void *Arg, KeySinkFlushFunc Flush)
+{
+    for (size_t i = 0; i < KeySinkNum; i++) {
+        if (KeySinks[i].Sink == Sink && KeySinks[i].Arg == Arg) {
+            KeySinks[i].Flush = Flush;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+//扫描结束时通知本次扫描中有事件输出的输出函数
+static void KeySink_Flush(void)
+{
+    for (size_t i = 0; i < KeySinkNum; i++) {
+        if (KeySinks[i].Pending) {
+            KeySinks[i].Pending = false;
+            if (KeySinks[i].Flush) {
+                KeySinks[i].Flush(KeySinks[i].Arg);
+            }
+        }
+    }
+}
+
+#if MYKEY_USE_GESTURE
+int MyKey_GestureAdd(const MyKeyGestureStep_t *Steps, size_t Num, size_t Timeout)
+{
+    if (Steps == NULL || Num == 0 || Num > MYKEY_GESTURE_MAX_STEPS || Timeout > KEY_TICK_MAX) {
+        return -1;
+    }
+    for (size_t k = 0; k < Num; k++) {
+        if (!KeyIndex_Valid(Steps[k].Key) || (Steps[k].EventMask & (MYKEY_EVENT_GESTURE - 1)) == 0) {
             return -1;
         }
-        p = p->Next_Key;
     }
+    for (int p = 0; p < MYKEY_MAX_GESTURES; p++) {
+        myKeyGesture_t *g = &KeyGestures[p];
+        if (g->Num == 0) {
+            for (size_t k = 0; k < Num; k++) {
+                g->Key[k] = (uint16_t)KEY_INDEX(Steps[k].Key);
+                g->EventMask[k] = Steps[k].EventMask & (MYKEY_EVENT_GESTURE - 1);
+            }
+            g->Timeout = (myKeyTick_t)Timeout;
+            g->Num = (uint8_t)Num;
+            return p;
+        }
+    }
+    return -1;
+}
 
-    myKey_t *NewKey = (myKey_t *)malloc(sizeof(myKey_t));
-    if (NewKey == NULL) {
+//计算状态From遇到符号（按键Key的事件Event）并且间隔区间为Cls时的下一个状态
+static void KeyGesture_Move(const myKeyGestureSet_t *From, uint16_t Key, uint8_t Event, uint32_t Cls,
+                            const uint8_t *Limit, myKeyGestureSet_t *To)
+{
+    memset(To, 0, sizeof(*To));
+    for (int p = 0; p < MYKEY_MAX_GESTURES; p++) {
+        const myKeyGesture_t *g = &KeyGestures[p];
+        for (int k = g->Num - 1; k >= 0; k--) {
+            if (g->Key[k] != Key || !(g->EventMask[k] & Event)) {
+                continue;
+            }
+            //第一步随时可以开始，之后的每一步要求前一步已经匹配并且没有超时
+            if (k > 0 && (Cls >= Limit[p] || !(From->Pos[KEY_GESTURE_POS(p, k) / 32] & (1UL << (KEY_GESTURE_POS(p, k) % 32))))) {
+                continue;
+            }
+            if (k + 1 == g->Num) {
+                To->Match |= 1UL << p;
+            } else {
+                To->Pos[KEY_GESTURE_POS(p, k + 1) / 32] |= 1UL << (KEY_GESTURE_POS(p, k + 1) % 32);
+            }
+        }
+    }
+}
+
+static bool KeyGesture_Equal(const myKeyGestureSet_t *a, const myKeyGestureSet_t *b)
+{
+    return (a->Match == b->Match) && (memcmp(a->Pos, b->Pos, sizeof(a->Pos)) == 0);
+}
+
+//从状态0开始依次计算每个状态的所有转移，新出现的状态加到最后，返回状态数，小于0表示失败
+static int KeyGesture_Build(const uint16_t *SymKey, const uint8_t *SymEvent, const uint8_t *Limit,
+                            myKeyGestureSet_t **Sets, uint16_t **Next)
+{
+    uint32_t stride = KeyGestureDfa.Stride;
+    uint32_t cls = KeyGestureDfa.TimeoutNum + 1U;
+    uint32_t cap = 16, num = 1;
+
+    *Sets = calloc(cap, sizeof(myKeyGestureSet_t));
+    *Next = malloc(cap * stride * sizeof(uint16_t));
+    if (*Sets == NULL || *Next == NULL) {
         return -1;
     }
-    NewKey->KeyStatus = func;
-    NewKey->KeyID = (MyKeyHandle)NewKey;
-    NewKey->Mode = Mode;
-    NewKey->State = KEYSTATE_RELASE;
-    NewKey->PressTime = 0;
-    NewKey->FilterCount = 0;
-    NewKey->RepeatSpeed = RepeatSpeed;
-    NewKey->RepeatCount = 0;
-    NewKey->LongPressTime = LongPressTime;
-    NewKey->ClickCount = 0;
-    NewKey->keyState = 0;
-    NewKey->DblClkCount = 0;
-    NewKey->Next_Key = NULL;
-
-    if (KeyList_Put(&MyKeyList, NewKey)) {
-        *Key = (MyKeyHandle)NewKey;
+    for (uint32_t s = 0; s < num; s++) {
+        for (uint32_t t = 0; t < stride; t++) {
+            myKeyGestureSet_t to;
+            uint32_t j = 0;
+            KeyGesture_Move(&(*Sets)[s], SymKey[t / cls], SymEvent[t / cls], t % cls, Limit, &to);
+            while (j < num && !KeyGesture_Equal(&(*Sets)[j], &to)) {
+                j++;
+            }
+            if (j == num) {
+                if (num == KEY_GESTURE_MAX_STATES) {
+                    return -1;
+                }
+                if (num == cap) {
+                    myKeyGestureSet_t *sets = realloc(*Sets, cap * 2 * sizeof(myKeyGestureSet_t));
+                    if (sets == NULL) {
+                        return -1;
+                    }
+                    *Sets = sets;
+                    uint16_t *next = realloc(*Next, cap * 2 * stride * sizeof(uint16_t));
+                    if (next == NULL) {
+                        return -1;
+                    }
+                    *Next = next;
+                    cap *= 2;
+                }
+                (*Sets)[num++] = to;
+            }
+            (*Next)[s * stride + t] = (uint16_t)j;
+        }
+    }
+    return (int)num;
+}
+
+void MyKey_GestureClear(void)
+{
+    free(KeyGestureDfa.Next);
+    free(KeyGestureDfa.Match);
+    memset(&KeyGestureDfa, 0, sizeof(KeyGestureDfa));
+    memset(KeyGestures, 0, sizeof(KeyGestures));
+}
+
+int MyKey_GestureCompile(void)
+{
+    myKeyGestureDfa_t *dfa = &KeyGestureDfa;
+    uint16_t symKey[MYKEY_MAX_GESTURES * MYKEY_GESTURE_MAX_STEPS * 5];
+    uint8_t symEvent[MYKEY_MAX_GESTURES * MYKEY_GESTURE_MAX_STEPS * 5];
+    uint8_t limit[MYKEY_MAX_GESTURES];
+    uint32_t symNum = 0;
+
+    free(dfa->Next);
+    free(dfa->Match);
+    memset(dfa, 0, sizeof(*dfa));
+
+    //手势中用到的按键事件编号为符号，事件只有低5位
+    for (int p = 0; p < MYKEY_MAX_GESTURES; p++) {
+        const myKeyGesture_t *g = &KeyGestures[p];
+        for (int k = 0; k < g->Num; k++) {
+            for (uint8_t m = g->EventMask[k]; m; m &= m - 1) {
+                int e = __builtin_ctz(m);
+                if (dfa->Sym[g->Key[k]][e] == 0) {
+                    symKey[symNum] = g->Key[k];
+                    symEvent[symNum] = (uint8_t)(1U << e);
+                    dfa->Sym[g->Key[k]][e] = (uint16_t)++symNum;
+                }
+            }
+        }
+    }
+    if (symNum == 0) {
         return 0;
-    } else {
-        free(NewKey);
+    }
+
+    //不同的间隔门限升序排列，每个手势的间隔区间小于Limit时没有超时
+    for (int p = 0; p < MYKEY_MAX_GESTURES; p++) {
+        myKeyTick_t t = KeyGestures[p].Timeout;
+        int n = 0;
+        if (KeyGestures[p].Num == 0 || t == 0) {
+            continue;
+        }
+        while (n < dfa->TimeoutNum && dfa->Timeouts[n] < t) {
+            n++;
+        }
+        if (n < dfa->TimeoutNum && dfa->Timeouts[n] == t) {
+            continue;
+        }
+        memmove(&dfa->Timeouts[n + 1], &dfa->Timeouts[n], (dfa->TimeoutNum - n) * sizeof(dfa->Timeouts[0]));
+        dfa->Timeouts[n] = t;
+        dfa->TimeoutNum++;
+    }
+    for (int p = 0; p < MYKEY_MAX_GESTURES; p++) {
+        uint8_t n = 0;
+        while (n < dfa->TimeoutNum && dfa->Timeouts[n] != KeyGestures[p].Timeout) {
+            n++;
+        }
+        limit[p] = (uint8_t)(n + 1);
+    }
+
+    //子集构造，状态0为没有匹配任何一步
+    myKeyGestureSet_t *sets = NULL;
+    uint16_t *next = NULL;
+    dfa->Stride = symNum * (dfa->TimeoutNum + 1U);
+    int num = KeyGesture_Build(symKey, symEvent, limit, &sets, &next);
+    if (num > 0) {
+        dfa->Match = malloc(num * sizeof(dfa->Match[0]));
+    }
+    if (num <= 0 || dfa->Match == NULL) {
+        free(sets);
+        free(next);
+        memset(dfa, 0, sizeof(*dfa));
         return -1;
     }
+    for (int n = 0; n < num; n++) {
+        dfa->Match[n] = sets[n].Match;
+    }
+    free(sets);
+    dfa->Next = next;
+    dfa->State = 0;
+    dfa->LastTime = KeyTime;
+    return num;
+}
+#else
+int MyKey_GestureAdd(const MyKeyGestureStep_t *Steps, size_t Num, size_t Timeout)
+{
+    (void)Steps;
+    (void)Num;
+    (void)Timeout;
+    return -1;
 }
 
-int MyKey_Unregister(MyKeyHandle *Key)
+void MyKey_GestureClear(void)
+{
+}
+
+int MyKey_GestureCompile(void)
 {
-    myKey_t *TempNode = (myKey_t *)(*Key);
-    myKey_t *p = NULL;
-    myKey_t *q = MyKeyList;
+    return -1;
+}
+#endif
 
-    if (TempNode == NULL) {         //无效指定节点
+static int KeyRegister_Common(MyKeyHandle *Key, KeyStatusFunc func, int Adc, size_t Level, unsigned char Mode, size_t RepeatSpeed, size_t LongPressTime)
+{
+    if (RepeatSpeed > KEY_TICK_MAX || LongPressTime > KEY_TICK_MAX) {
         return -1;
     }
 
-    //查找是否存在
-    while (q != NULL) {
-        if (q->KeyID == *Key) {
-            break;
+    //先检查按键是否已经被注册过了
+    for (int i = 0; i < MYKEY_MAX_KEYS; i++) {
+        if (!KeyIndex_Valid(KEY_HANDLE(i))) {
+            continue;
+        }
+        if (Adc == 0 && func != NULL && __atomic_load_n(&KeyConf.KeyStatus[i], __ATOMIC_RELAXED) == func) {
+            return -1;
+        }
+        if (Adc != 0 && KeyConf.Adc[i] == Adc && KeyConf.AdcLevel[i] == Level) {
+            return -1;
         }
-        q = q->Next_Key;
     }
-    if (q == NULL) {
+
+    int i = KeyIndex_Alloc();
+    if (i < 0) {
+        return -1;
+    }
+    __atomic_store_n(&KeyConf.KeyStatus[i], func, __ATOMIC_RELAXED);
+    KeyConf.Adc[i] = (uint8_t)Adc;
+    KeyConf.AdcLevel[i] = (uint8_t)Level;
+    KeyConf.Mode[i] = Mode;
+    KeyConf.RepeatSpeed[i] = (myKeyTick_t)RepeatSpeed;
+    KeyConf.LongPressTime[i] = (myKeyTick_t)LongPressTime;
+    KeyConf.Callback[i] = NULL;
+    KeyConf.CallMode[i] = MYKEY_CALLBACK_INLINE;
+    __atomic_fetch_and(&KeyInputLevel[i / 32], ~(1UL << (i % 32)), __ATOMIC_RELAXED);
+    KeyIndex_Publish(i);
+    *Key = KEY_HANDLE(i);
+    return 0;
+}
+
+int MyKey_Register(MyKeyHandle *Key, KeyStatusFunc func, unsigned char Mode, size_t RepeatSpeed, size_t LongPressTime)
+{
+    if (func == NULL) {
         return -1;
     }
-    q = MyKeyList;
+    return KeyRegister_Common(Key, func, 0, 0, Mode, RepeatSpeed, LongPressTime);
+}
 
-    //存在
-    if (MyKeyList == NULL) {        //无效链表头节点
-        if (TempNode->KeyID == *Key) {
-            free(TempNode);             //释放掉被删除的节点
-            *Key = NULL;
+int MyKey_AdcCreate(MyKeyAdcHandle *Adc, KeyAdcFunc func, const uint16_t *Thresholds, size_t Num, uint16_t Hysteresis)
+{
+    if (Adc == NULL || func == NULL || Thresholds == NULL || Num == 0 || Num > 254) {
+        return -1;
+    }
+    for (size_t n = 1; n < Num; n++) {
+        if (Thresholds[n] <= Thresholds[n - 1]) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < MYKEY_MAX_ADCS; i++) {
+        if (KeyAdcs[i].Sample == NULL) {
+            KeyAdcs[i].Thresholds = Thresholds;
+            KeyAdcs[i].Num = (uint8_t)Num;
+            KeyAdcs[i].Level = (uint8_t)Num;
+            KeyAdcs[i].Hysteresis = Hysteresis;
+            KeyAdcs[i].SampleSeq = 0;
+            KeyAdcs[i].Sample = func;
+            *Adc = (MyKeyAdcHandle)(uintptr_t)(i + 1);
             return 0;
         }
+    }
+    return -1;
+}
+
+int MyKey_AdcDelete(MyKeyAdcHandle *Adc)
+{
+    if (Adc == NULL) {
+        return -1;
+    }
+    int n = (int)(uintptr_t)(*Adc);
+    if (n < 1 || n > MYKEY_MAX_ADCS || KeyAdcs[n - 1].Sample == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < MYKEY_MAX_KEYS; i++) {
+        if (KeyIndex_Valid(KEY_HANDLE(i)) && KeyConf.Adc[i] == n) {
+            return -1;
+        }
+    }
+    KeyAdcs[n - 1].Sample = NULL;
+    *Adc = NULL;
+    return 0;
+}
+
+int MyKey_RegisterAdc(MyKeyHandle *Key, MyKeyAdcHandle Adc, size_t Level, unsigned char Mode, size_t RepeatSpeed, size_t LongPressTime)
+{
+    int n = (int)(uintptr_t)Adc;
+    if (n < 1 || n > MYKEY_MAX_ADCS || KeyAdcs[n - 1].Sample == NULL || Level > KeyAdcs[n - 1].Num) {
         return -1;
     }
+    return KeyRegister_Common(Key, NULL, n, Level, Mode, RepeatSpeed, LongPressTime);
+}
+
+int MyKey_RegisterInput(MyKeyHandle *Key, unsigned char Mode, size_t RepeatSpeed, size_t LongPressTime)
+{
+    return KeyRegister_Common(Key, NULL, 0, 0, Mode, RepeatSpeed, LongPressTime);
+}
 
-    while (q != TempNode && q != NULL) {
-        p = q;
-        q = q->Next_Key;
+int MyKey_SetInput(MyKeyHandle Key, int Level)
+{
+    if (!KeyIndex_Valid(Key)) {
+        return -1;
+    }
+    int i = KEY_INDEX(Key);
+    if (__atomic_load_n(&KeyConf.KeyStatus[i], __ATOMIC_RELAXED) != NULL || KeyConf.Adc[i] != 0) {
+        return -1;
+    }
+    uint32_t bit = 1UL << (i % 32);
+    if (Level == 1) {
+        __atomic_fetch_or(&KeyInputLevel[i / 32], bit, __ATOMIC_RELEASE);
+    } else {
+        __atomic_fetch_and(&KeyInputLevel[i / 32], ~bit, __ATOMIC_RELEASE);
     }
+    return 0;
+}
 
-    if (q != TempNode) {            //链表中不存在该节点
-        if (TempNode->KeyID == *Key) {
-            free(TempNode);             //释放掉被删除的节点
-            *Key = NULL;
-            return 0;
+int MyKey_SetProbe(KeyProbeFunc Probe)
+{
+    __atomic_store_n(&KeyProbe, Probe, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int MyKey_SetCallback(MyKeyHandle Key, KeyEventCallback Callback, int CallMode)
+{
+    if (!KeyIndex_Valid(Key) || (CallMode != MYKEY_CALLBACK_INLINE && CallMode != MYKEY_CALLBACK_DEFERRED)) {
+        return -1;
+    }
+    int i = KEY_INDEX(Key);
+    KeyConf.CallMode[i] = (uint8_t)CallMode;
+    __atomic_store_n(&KeyConf.Callback[i], Callback, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int MyKey_Unregister(MyKeyHandle *Key)
+{
+    if (Key == NULL || !KeyIndex_Valid(*Key)) {
+        return -1;
+    }
+    int i = KEY_INDEX(*Key);
+    uint32_t bit = 1UL << (i % 32);
+    //先撤销发布，正在进行的扫描可能还在使用该按键，等扫描结束之后才能回收
+    if (!(__atomic_fetch_and(&KeyIndexUsed[i / 32], ~bit, __ATOMIC_SEQ_CST) & bit)) {
+        return -1;
+    }
+    __atomic_store_n(&KeyRetireSeq[i], __atomic_load_n(&KeyScanSeq, __ATOMIC_SEQ_CST) | KEY_RETIRED, __ATOMIC_RELEASE);
+    __atomic_fetch_or(&KeyIndexRetired[i / 32], bit, __ATOMIC_RELEASE);
+    *Key = NULL;
+    return 0;
+}
+
+#define KEY_IMAGE_HEAD_SIZE             MYKEY_IMAGE_SIZE(0)
+#define KEY_IMAGE_ENTRY_SIZE            (MYKEY_IMAGE_SIZE(1) - MYKEY_IMAGE_SIZE(0))
+
+int MyKey_LoadImage(const uint8_t *Image, size_t Size, const KeyStatusFunc *Sources, size_t SourceNum, MyKeyHandle *Keys)
+{
+    if (Image == NULL || Size < KEY_IMAGE_HEAD_SIZE || memcmp(Image, "MKTB", 4) != 0 || Image[4] != MYKEY_IMAGE_VERSION) {
+        return -1;
+    }
+    size_t num = Image[6] | ((size_t)Image[7] << 8);
+    if (num > MYKEY_MAX_KEYS || Size < MYKEY_IMAGE_SIZE(num)) {
+        return -1;
+    }
+
+    //先检查所有按键，不注册任何按键
+    const uint8_t *entry = Image + KEY_IMAGE_HEAD_SIZE;
+    for (size_t n = 0; n < num; n++, entry += KEY_IMAGE_ENTRY_SIZE) {
+        uint8_t source = entry[1];
+        uint8_t level = entry[2];
+        if (level == MYKEY_IMAGE_DIGITAL) {
+            if (Sources == NULL || source >= SourceNum || Sources[source] == NULL) {
+                return -1;
+            }
+        } else if (source >= MYKEY_MAX_ADCS || KeyAdcs[source].Sample == NULL || level > KeyAdcs[source].Num) {
+            return -1;
+        }
+        //与注册时的检查相同：同一个读取函数或者同一个模拟按键区间不能对应两个按键
+        for (const uint8_t *prev = Image + KEY_IMAGE_HEAD_SIZE; prev < entry; prev += KEY_IMAGE_ENTRY_SIZE) {
+            if (level == MYKEY_IMAGE_DIGITAL) {
+                if (prev[2] == MYKEY_IMAGE_DIGITAL && Sources[prev[1]] == Sources[source]) {
+                    return -1;
+                }
+            } else if (prev[2] == level && prev[1] == source) {
+                return -1;
+            }
+        }
+    }
+
+    //整字占用按键序号，按键表不是空的时候失败
+    uint32_t mask[MYKEY_SNAPSHOT_WORDS] = {0};
+    for (size_t n = 0; n < num; n++) {
+        mask[n / 32] |= 1UL << (n % 32);
+    }
+    KeyIndex_Reclaim();
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        uint32_t claimed = 0;
+        if (!__atomic_compare_exchange_n(&KeyIndexClaimed[w], &claimed, mask[w], false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            while (w--) {
+                __atomic_store_n(&KeyIndexClaimed[w], 0, __ATOMIC_RELEASE);
+            }
+            return -1;
+        }
+    }
+
+    entry = Image + KEY_IMAGE_HEAD_SIZE;
+    for (size_t n = 0; n < num; n++, entry += KEY_IMAGE_ENTRY_SIZE) {
+        uint8_t source = entry[1];
+        uint8_t level = entry[2];
+        if (level == MYKEY_IMAGE_DIGITAL) {
+            __atomic_store_n(&KeyConf.KeyStatus[n], Sources[source], __ATOMIC_RELAXED);
+            KeyConf.Adc[n] = 0;
+            KeyConf.AdcLevel[n] = 0;
+        } else {
+            __atomic_store_n(&KeyConf.KeyStatus[n], NULL, __ATOMIC_RELAXED);
+            KeyConf.Adc[n] = source + 1;
+            KeyConf.AdcLevel[n] = level;
+        }
+        KeyConf.Mode[n] = entry[0];
+        KeyConf.RepeatSpeed[n] = (myKeyTick_t)((entry[4] | (entry[5] << 8)) * MYKEY_TICKS_PER_MS);
+        KeyConf.LongPressTime[n] = (myKeyTick_t)((entry[6] | (entry[7] << 8)) * MYKEY_TICKS_PER_MS);
+        KeyConf.Callback[n] = NULL;
+        KeyConf.CallMode[n] = MYKEY_CALLBACK_INLINE;
+        if (Keys) {
+            Keys[n] = KEY_HANDLE(n);
+        }
+    }
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        __atomic_fetch_or(&KeyIndexNew[w], mask[w], __ATOMIC_RELEASE);
+        __atomic_fetch_or(&KeyIndexUsed[w], mask[w], __ATOMIC_RELEASE);
+    }
+    return (int)num;
+}
+
+//输入按键的状态来源（如fd和按键码）由注册它的模块管理，不保存到镜像中
+static bool KeyImage_Skip(int i)
+{
+    return KeyConf.Adc[i] == 0 && __atomic_load_n(&KeyConf.KeyStatus[i], __ATOMIC_RELAXED) == NULL;
+}
+
+int MyKey_SaveImage(uint8_t *Image, size_t Size, const KeyStatusFunc *Sources, size_t SourceNum)
+{
+    size_t num = 0;
+    for (int i = 0; i < MYKEY_MAX_KEYS; i++) {
+        if (KeyIndex_Valid(KEY_HANDLE(i)) && !KeyImage_Skip(i)) {
+            num++;
         }
+    }
+    if (Image == NULL) {
+        return MYKEY_IMAGE_SIZE(num);
+    }
+    if (Size < MYKEY_IMAGE_SIZE(num)) {
         return -1;
     }
 
-    if (q->KeyID == *Key) {
-        if (q == MyKeyList) {           //删除的是第一个节点
-            MyKeyList = MyKeyList->Next_Key;
+    uint8_t *entry = Image + KEY_IMAGE_HEAD_SIZE;
+    size_t n = 0;
+    for (int i = 0; i < MYKEY_MAX_KEYS && n < num; i++) {
+        if (!KeyIndex_Valid(KEY_HANDLE(i)) || KeyImage_Skip(i)) {
+            continue;
+        }
+        if (KeyConf.Adc[i]) {
+            entry[1] = KeyConf.Adc[i] - 1;
+            entry[2] = KeyConf.AdcLevel[i];
         } else {
-            p->Next_Key = q->Next_Key;
+            KeyStatusFunc func = __atomic_load_n(&KeyConf.KeyStatus[i], __ATOMIC_RELAXED);
+            size_t source = 0;
+            while (source < SourceNum && Sources[source] != func) {
+                source++;
+            }
+            if (source >= SourceNum || source >= MYKEY_IMAGE_DIGITAL) {
+                return -1;
+            }
+            entry[1] = (uint8_t)source;
+            entry[2] = MYKEY_IMAGE_DIGITAL;
+        }
+        //镜像中的时间单位为ms，不是整数ms的时间保存后会被截断，不能保存
+        if ((KeyConf.RepeatSpeed[i] % MYKEY_TICKS_PER_MS) != 0 || (KeyConf.LongPressTime[i] % MYKEY_TICKS_PER_MS) != 0) {
+            return -1;
+        }
+        uint32_t repeat = KeyConf.RepeatSpeed[i] / MYKEY_TICKS_PER_MS;
+        uint32_t longPress = KeyConf.LongPressTime[i] / MYKEY_TICKS_PER_MS;
+        if (repeat > 0xFFFF || longPress > 0xFFFF) {
+            return -1;
+        }
+        entry[0] = KeyConf.Mode[i];
+        entry[3] = 0;
+        entry[4] = (uint8_t)(repeat & 0xFF);
+        entry[5] = (uint8_t)(repeat >> 8);
+        entry[6] = (uint8_t)(longPress & 0xFF);
+        entry[7] = (uint8_t)(longPress >> 8);
+        entry += KEY_IMAGE_ENTRY_SIZE;
+        n++;
+    }
+    const uint8_t head[KEY_IMAGE_HEAD_SIZE] = { MYKEY_IMAGE_HEAD(n) };
+    memcpy(Image, head, sizeof(head));
+    return MYKEY_IMAGE_SIZE(n);
+}
+
+int MyKey_GetIndex(MyKeyHandle Key)
+{
+    return KeyIndex_Valid(Key) ? KEY_INDEX(Key) : -1;
+}
+
+int MyKey_GetStats(MyKeyHandle Key, MyKeyStats_t *Stats)
+{
+#if MYKEY_USE_STATS
+    if (!KeyIndex_Valid(Key) || Stats == NULL) {
+        return -1;
+    }
+    myKeyStatsRec_t *rec = &KeyStats[KEY_INDEX(Key)];
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&rec->Seq, __ATOMIC_ACQUIRE);
+        memcpy(Stats, &rec->Stats, sizeof(MyKeyStats_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || (seq != __atomic_load_n(&rec->Seq, __ATOMIC_RELAXED)));
+    return 0;
+#else
+    (void)Key;
+    (void)Stats;
+    return -1;
+#endif
+}
+
+uint64_t MyKey_GetTime(void)
+{
+    return KeyTime;
+}
+
+int MyKey_Idle(void)
+{
+    uint32_t used[MYKEY_SNAPSHOT_WORDS];
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        used[w] = __atomic_load_n(&KeyIndexUsed[w], __ATOMIC_ACQUIRE);
+        //新注册的按键还没有扫描过
+        if (__atomic_load_n(&KeyIndexNew[w], __ATOMIC_ACQUIRE) & used[w]) {
+            return 0;
         }
-        free(q);                        //释放掉被删除的节点
-        *Key = NULL;
-        return 0;
     }
+    return (KeyIndex_Idle(used) && !KeyInput_Any(used)) ? 1 : 0;
+}
+
+int MyKey_TraceStart(KeyTraceClockFunc Clock)
+{
+#if MYKEY_USE_TRACE
+    __atomic_store_n(&KeyTraceClock, Clock, __ATOMIC_RELEASE);
+    return 0;
+#else
+    (void)Clock;
     return -1;
+#endif
+}
+
+int MyKey_TraceExport(KeyTraceWriteFunc Write, void *Arg)
+{
+#if MYKEY_USE_TRACE
+    static const char head[] = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+                               "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"MyKey_Scan\"}}";
+    static const char tail[] = "\n]}\n";
+    char buf[256];
+    int count = 0;
+
+    if (Write == NULL) {
+        return -1;
+    }
+    if (Write(head, sizeof(head) - 1, Arg) != 0) {
+        return -1;
+    }
+    //只导出开始导出时已经写入的记录，被覆盖的记录被跳过
+    uint32_t total = __atomic_load_n(&KeyTraceNum, __ATOMIC_ACQUIRE);
+    uint32_t n = (total > MYKEY_TRACE_NUM) ? (total - MYKEY_TRACE_NUM) : 0;
+    myKeyTraceRec_t rec;
+    while ((int32_t)(total - n) > 0 && myQueueLappedGet(KeyTraceRing, MYKEY_TRACE_NUM, sizeof(myKeyTraceRec_t), &KeyTraceNum, &n, &rec)) {
+        //Chrome trace的时间单位是us
+        int len = snprintf(buf, sizeof(buf),
+                           ",\n{\"name\":\"MyKey_Scan\",\"cat\":\"mykey\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                           "\"ts\":%llu.%03u,\"dur\":%u.%03u,"
+                           "\"args\":{\"seq\":%u,\"tick_us\":%llu,\"keys\":%u,\"callbacks\":%u,\"events\":%u}}",
+                           (unsigned long long)(rec.Start / 1000), (unsigned)(rec.Start % 1000),
+                           (unsigned)(rec.Duration / 1000), (unsigned)(rec.Duration % 1000),
+                           (unsigned)(n - 1), (unsigned long long)rec.Tick * 1000 / MYKEY_TICKS_PER_MS, rec.Visited, rec.Callbacks, rec.Events);
+        if (Write(buf, (size_t)len, Arg) != 0) {
+            return -1;
+        }
+        count++;
+    }
+    if (Write(tail, sizeof(tail) - 1, Arg) != 0) {
+        return -1;
+    }
+    return count;
+#else
+    (void)Write;
+    (void)Arg;
+    return -1;
+#endif
+}
+
+void MyKey_Snapshot(uint32_t *Bitmap)
+{
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&KeyStateSeq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+        for (int i = 0; i < MYKEY_SNAPSHOT_WORDS; i++) {
+            Bitmap[i] = __atomic_load_n(&KeyStateBits[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || (seq != __atomic_load_n(&KeyStateSeq, __ATOMIC_RELAXED)));
 }
 
 void MyKey_PrintKeyInfo(void)
 {
-    myKey_t *q = MyKeyList;
-    if (q == NULL) {
-        printf("NO KEY\r\n");
+    bool found = false;
+    for (int i = 0; i < MYKEY_MAX_KEYS; i++) {
+        if (KeyIndex_Valid(KEY_HANDLE(i))) {
+            printf("KEY ID : %p\r\n", KEY_HANDLE(i));
+            found = true;
+        }
     }
-    while (q != NULL) {
-        printf("KEY ID : %p\r\n", q->KeyID);
-        q = q->Next_Key;
+    if (!found) {
+        printf("NO KEY\r\n");
     }
 }
 
-void MyKey_Scan(size_t InterVal)
+static void KeyScan_One(int i, myKeyTick_t InterVal)
 {
-    myKey_t *p = MyKeyList;
-    while (p != NULL) {
-        if (p->KeyStatus() == 1) {
-            //按下消抖
-            if (p->FilterCount < KEY_FILTER_TIME) {
-                p->FilterCount = KEY_FILTER_TIME;
-            } else if (p->FilterCount < (KEY_FILTER_TIME + KEY_FILTER_TIME)) {
-                p->FilterCount += InterVal;
-            } else {
-                //消抖时间已到，上一次状态为弹起
-                if (p->keyState == 0) {
-                    p->keyState = 1;
-                    //第一次按下
-                    if (p->State == KEYSTATE_RELASE) {
-                        p->ClickCount = 1;
-                        p->DblClkCount = 0;         //双击等待时间清除
-                        p->PressTime = 0;           //长按计时复位
-                        p->RepeatCount = 0;         //连续触发计时复位
-                        //支持单击和双击
-                        if ( ((p->Mode)&MYKEY_EVENT_CLICK) && ((p->Mode)&MYKEY_EVENT_DBLCLICK) ) {
-                            p->State = KEYSTATE_PRESS_SD;
-                        } else if ((p->Mode)&MYKEY_EVENT_CLICK) {
-                            //仅支持单击
-                            p->State = KEYSTATE_PRESS_S;
-                            //即不支持长按，也不支持连续触发
-                            if (!( ((p->Mode)&MYKEY_EVENT_LONG_PRESS) || ((p->Mode)&MYKEY_EVENT_REPEAT) )) {
-                                //发送单击按键消息
-                                KeyMessage_Put(p->KeyID, MYKEY_EVENT_CLICK, p->ClickCount);
-                            }
-                        } else if ((p->Mode)&MYKEY_EVENT_DBLCLICK) {
-                            //仅支持双击
-                            p->State = KEYSTATE_PRESS_D;
-                        }
-                    } else if (p->State == KEYSTATE_PRESS_SD  || p->State == KEYSTATE_PRESS_D) {
-                        //上一次为支持双击按下（支持单击和双击、仅支持双击）
-                        p->DblClkCount = 0;                     //连击间隔时间清0
-                        //连续按次数加1
-                        if (p->ClickCount < 255) {
-                            p->ClickCount++;
+#if MYKEY_USE_STATS
+    //读到的状态变回消抖后的状态，说明上一次的变化是抖动
+    uint8_t raw = KeyLane.Raw[i] ? KEY_FLAG_RAW : 0;
+    if ((raw ^ KeyHot.Flags[i]) & KEY_FLAG_RAW) {
+        if (!raw == !(KeyHot.Flags[i] & KEY_FLAG_PRESSED)) {
+            KEY_STATS_INC(i, Bounces);
+        }
+        KeyHot.Flags[i] ^= KEY_FLAG_RAW;
+    }
+#endif
+    if (KeyLane.Raw[i]) {
+        //按下消抖
+        if (KeyHot.FilterCount[i] < KEY_FILTER_TIME) {
+            KeyHot.FilterCount[i] = KEY_FILTER_TIME;
+        } else if (KeyHot.FilterCount[i] < (KEY_FILTER_TIME + KEY_FILTER_TIME)) {
+            KeyHot.FilterCount[i] = KeyTick_Add(KeyHot.FilterCount[i], InterVal);
+        } else {
+            //消抖时间已到，上一次状态为弹起
+            if (!(KeyHot.Flags[i] & KEY_FLAG_PRESSED)) {
+                KeyHot.Flags[i] |= KEY_FLAG_PRESSED;
+                KeyState_Set(i, 1);
+#if MYKEY_USE_STATS
+                KeyStats[i].PressStamp = KeyTime;
+                KEY_STATS_INC(i, Presses);
+#endif
+                //第一次按下
+                if (KEY_STATE(i) == KEYSTATE_RELASE) {
+                    KeyHot.ClickCount[i] = 1;
+                    KeyHot.DblClkCount[i] = 0;         //双击等待时间清除
+                    KeyHot.PressTime[i] = 0;           //长按计时复位
+                    KeyHot.RepeatCount[i] = 0;         //连续触发计时复位
+                    //支持单击和双击
+                    if ( (KeyConf.Mode[i]&MYKEY_EVENT_CLICK) && (KeyConf.Mode[i]&MYKEY_EVENT_DBLCLICK) ) {
+                        KEY_SET_STATE(i, KEYSTATE_PRESS_SD);
+                    } else if (KeyConf.Mode[i]&MYKEY_EVENT_CLICK) {
+                        //仅支持单击
+                        KEY_SET_STATE(i, KEYSTATE_PRESS_S);
+                        //即不支持长按，也不支持连续触发
+                        if (!( (KeyConf.Mode[i]&MYKEY_EVENT_LONG_PRESS) || (KeyConf.Mode[i]&MYKEY_EVENT_REPEAT) )) {
+                            //发送单击按键消息
+                            KeyMessage_Put(i, MYKEY_EVENT_CLICK, KeyHot.ClickCount[i]);
                         }
+                    } else if (KeyConf.Mode[i]&MYKEY_EVENT_DBLCLICK) {
+                        //仅支持双击
+                        KEY_SET_STATE(i, KEYSTATE_PRESS_D);
                     }
-                } else {
-                    //持续按住
-                    //同时使能长按和连续触发，长按时间到达之后开始连续触发，不发送长按消息
-                    if ( ((p->Mode)&MYKEY_EVENT_LONG_PRESS) && ((p->Mode)&MYKEY_EVENT_REPEAT) ) {
-                        if (p->PressTime < p->LongPressTime) {
-                            p->PressTime += InterVal;
-                            if (p->PressTime >= p->LongPressTime) {
-                                p->RepeatCount = 0;             //重复触发计时清0
-                                p->State = KEYSTATE_PRESS_LR;
-                                //发送按键长按消息
-                                //KeyMessage_Put(p->KeyID,MYKEY_EVENT_LONG_PRESS);
-                            }
-                        } else {
-                            p->RepeatCount += InterVal;
-                            if (p->RepeatCount >= p->RepeatSpeed) {
-                                p->RepeatCount = 0;
-                                p->State = KEYSTATE_PRESS_LR;
-                                //发送连续按键消息
-                                KeyMessage_Put(p->KeyID, MYKEY_EVENT_REPEAT, p->ClickCount);
-                                if (p->ClickCount < 255) {
-                                    p->ClickCount++;
-                                }
-                            }
-                        }
-                    } else if ((p->Mode)&MYKEY_EVENT_LONG_PRESS) {
-                        //只使能长按功能
-                        if (p->PressTime < p->LongPressTime) {
-                            p->PressTime += InterVal;
-                            if (p->PressTime >= p->LongPressTime) {
-                                p->State = KEYSTATE_PRESS_L;
-                                //发送按键长按消息
-                                KeyMessage_Put(p->KeyID, MYKEY_EVENT_LONG_PRESS, p->ClickCount);
-                            }
+                } else if (KEY_STATE(i) == KEYSTATE_PRESS_SD  || KEY_STATE(i) == KEYSTATE_PRESS_D) {
+                    //上一次为支持双击按下（支持单击和双击、仅支持双击）
+                    KeyHot.DblClkCount[i] = 0;                     //连击间隔时间清0
+                    //连续按次数加1
+                    if (KeyHot.ClickCount[i] < 255) {
+                        KeyHot.ClickCount[i]++;
+                    }
+                }
+            } else {
+                //持续按住
+                //同时使能长按和连续触发，长按时间到达之后开始连续触发，不发送长按消息
+                if ( (KeyConf.Mode[i]&MYKEY_EVENT_LONG_PRESS) && (KeyConf.Mode[i]&MYKEY_EVENT_REPEAT) ) {
+                    if (KeyHot.PressTime[i] < KeyConf.LongPressTime[i]) {
+                        KeyHot.PressTime[i] = KeyTick_Add(KeyHot.PressTime[i], InterVal);
+                        if (KeyHot.PressTime[i] >= KeyConf.LongPressTime[i]) {
+                            KeyHot.RepeatCount[i] = 0;             //重复触发计时清0
+                            KEY_SET_STATE(i, KEYSTATE_PRESS_LR);
+                            KEY_STATS_INC(i, LongPresses);
+                            //发送按键长按消息
+                            //KeyMessage_Put(i,MYKEY_EVENT_LONG_PRESS);
                         }
-                    } else if ((p->Mode)&MYKEY_EVENT_REPEAT) {
-                        //只使能连发功能
-                        p->RepeatCount += InterVal;
-                        if (p->RepeatCount >= p->RepeatSpeed) {
-                            p->RepeatCount = 0;
-                            p->State = KEYSTATE_PRESS_R;
+                    } else {
+                        KeyHot.RepeatCount[i] = KeyTick_Add(KeyHot.RepeatCount[i], InterVal);
+                        if (KeyHot.RepeatCount[i] >= KeyConf.RepeatSpeed[i]) {
+                            KeyHot.RepeatCount[i] = 0;
+                            KEY_SET_STATE(i, KEYSTATE_PRESS_LR);
+                            KEY_STATS_INC(i, Repeats);
                             //发送连续按键消息
-                            KeyMessage_Put(p->KeyID, MYKEY_EVENT_REPEAT, p->ClickCount);
-                            if (p->ClickCount < 255) {
-                                p->ClickCount++;
+                            KeyMessage_Put(i, MYKEY_EVENT_REPEAT, KeyHot.ClickCount[i]);
+                            if (KeyHot.ClickCount[i] < 255) {
+                                KeyHot.ClickCount[i]++;
                             }
                         }
                     }
-                }
-            }
-        } else {
-            //弹起消抖
-            if (p->FilterCount > KEY_FILTER_TIME) {
-                p->FilterCount = KEY_FILTER_TIME;
-            } else if (p->FilterCount != 0) {
-                if (p->FilterCount >= InterVal) {
-                    p->FilterCount -= InterVal;
-                } else {
-                    p->FilterCount = 0;
-                }
-            } else {
-                //消抖时间到
-                p->keyState = 0;
-                switch (p->State) {
-                    //支持单击和双击
-                    case KEYSTATE_PRESS_SD: {
-                        p->DblClkCount += InterVal;
-                        //超过时间没有双击
-                        if (p->DblClkCount >= KEY_DBL_INTERVAL) {
-                            p->State = KEYSTATE_RELASE;
-                            p->DblClkCount = 0;
-                            if (p->ClickCount <= 1) {
-                                //发送单击按键消息
-                                KeyMessage_Put(p->KeyID, MYKEY_EVENT_CLICK, p->ClickCount);
-                            } else {
-                                //发送连击按键消息
-                                KeyMessage_Put(p->KeyID, MYKEY_EVENT_DBLCLICK, p->ClickCount);
-                            }
-                            p->ClickCount = 0;
+                } else if (KeyConf.Mode[i]&MYKEY_EVENT_LONG_PRESS) {
+                    //只使能长按功能
+                    if (KeyHot.PressTime[i] < KeyConf.LongPressTime[i]) {
+                        KeyHot.PressTime[i] = KeyTick_Add(KeyHot.PressTime[i], InterVal);
+                        if (KeyHot.PressTime[i] >= KeyConf.LongPressTime[i]) {
+                            KEY_SET_STATE(i, KEYSTATE_PRESS_L);
+                            KEY_STATS_INC(i, LongPresses);
+                            //发送按键长按消息
+                            KeyMessage_Put(i, MYKEY_EVENT_LONG_PRESS, KeyHot.ClickCount[i]);
                         }
                     }
-                    break;
-
-                    //仅支持双击
-                    case KEYSTATE_PRESS_D: {
-                        p->DblClkCount += InterVal;
-                        //超过时间没有双击
-                        if (p->DblClkCount >= KEY_DBL_INTERVAL) {
-                            p->State = KEYSTATE_RELASE;
-                            p->DblClkCount = 0;
-                            //发送连击消息
-                            KeyMessage_Put(p->KeyID, MYKEY_EVENT_DBLCLICK, p->ClickCount);
-                            p->ClickCount = 0;
+                } else if (KeyConf.Mode[i]&MYKEY_EVENT_REPEAT) {
+                    //只使能连发功能
+                    KeyHot.RepeatCount[i] = KeyTick_Add(KeyHot.RepeatCount[i], InterVal);
+                    if (KeyHot.RepeatCount[i] >= KeyConf.RepeatSpeed[i]) {
+                        KeyHot.RepeatCount[i] = 0;
+                        KEY_SET_STATE(i, KEYSTATE_PRESS_R);
+                        KEY_STATS_INC(i, Repeats);
+                        //发送连续按键消息
+                        KeyMessage_Put(i, MYKEY_EVENT_REPEAT, KeyHot.ClickCount[i]);
+                        if (KeyHot.ClickCount[i] < 255) {
+                            KeyHot.ClickCount[i]++;
                         }
                     }
-                    break;
-
-                    //仅支持单击
-                    case KEYSTATE_PRESS_S: {
-                        p->State = KEYSTATE_RELASE;
-                        //即不支持长按，也不支持连续触发
-                        if (!( ((p->Mode)&MYKEY_EVENT_LONG_PRESS) || ((p->Mode)&MYKEY_EVENT_REPEAT) )) {
-                            //发送按键松开消息
-                            KeyMessage_Put(p->KeyID, MYKEY_EVENT_RELASE, p->ClickCount);
-                        } else {
+                }
+            }
+        }
+    } else {
+        //弹起消抖
+        if (KeyHot.FilterCount[i] > KEY_FILTER_TIME) {
+            KeyHot.FilterCount[i] = KEY_FILTER_TIME;
+        } else if (KeyHot.FilterCount[i] != 0) {
+            if (KeyHot.FilterCount[i] >= InterVal) {
+                KeyHot.FilterCount[i] -= InterVal;
+            } else {
+                KeyHot.FilterCount[i] = 0;
+            }
+        } else {
+            //消抖时间到
+            if (KeyHot.Flags[i] & KEY_FLAG_PRESSED) {
+                KeyHot.Flags[i] &= ~KEY_FLAG_PRESSED;
+                KeyState_Set(i, 0);
+#if MYKEY_USE_STATS
+                KeyStats_Hold(i);
+#endif
+            }
+            switch (KEY_STATE(i)) {
+                //支持单击和双击
+                case KEYSTATE_PRESS_SD: {
+                    KeyHot.DblClkCount[i] = KeyTick_Add(KeyHot.DblClkCount[i], InterVal);
+                    //超过时间没有双击
+                    if (KeyHot.DblClkCount[i] >= KEY_DBL_INTERVAL) {
+                        KEY_SET_STATE(i, KEYSTATE_RELASE);
+                        KeyHot.DblClkCount[i] = 0;
+                        if (KeyHot.ClickCount[i] <= 1) {
                             //发送单击按键消息
-                            KeyMessage_Put(p->KeyID, MYKEY_EVENT_CLICK, p->ClickCount);
+                            KeyMessage_Put(i, MYKEY_EVENT_CLICK, KeyHot.ClickCount[i]);
+                        } else {
+                            //发送连击按键消息
+                            KeyMessage_Put(i, MYKEY_EVENT_DBLCLICK, KeyHot.ClickCount[i]);
                         }
+                        KeyHot.ClickCount[i] = 0;
                     }
-                    break;
-
-                    //支持长按和连续触发
-                    case KEYSTATE_PRESS_LR:
-                    //仅支持长按
-                    case KEYSTATE_PRESS_L:
-                    //仅支持连续触发
-                    case KEYSTATE_PRESS_R: {
-                        p->State = KEYSTATE_RELASE;
-                        //发送按键松开消息
-                        KeyMessage_Put(p->KeyID, MYKEY_EVENT_RELASE, p->ClickCount);
+                }
+                break;
+
+                //仅支持双击
+                case KEYSTATE_PRESS_D: {
+                    KeyHot.DblClkCount[i] = KeyTick_Add(KeyHot.DblClkCount[i], InterVal);
+                    //超过时间没有双击
+                    if (KeyHot.DblClkCount[i] >= KEY_DBL_INTERVAL) {
+                        KEY_SET_STATE(i, KEYSTATE_RELASE);
+                        KeyHot.DblClkCount[i] = 0;
+                        //发送连击消息
+                        KeyMessage_Put(i, MYKEY_EVENT_DBLCLICK, KeyHot.ClickCount[i]);
+                        KeyHot.ClickCount[i] = 0;
                     }
-                    break;
+                }
+                break;
 
-                    default: {
-                        p->State = KEYSTATE_RELASE;
+                //仅支持单击
+                case KEYSTATE_PRESS_S: {
+                    KEY_SET_STATE(i, KEYSTATE_RELASE);
+                    //即不支持长按，也不支持连续触发
+                    if (!( (KeyConf.Mode[i]&MYKEY_EVENT_LONG_PRESS) || (KeyConf.Mode[i]&MYKEY_EVENT_REPEAT) )) {
+                        //发送按键松开消息
+                        KeyMessage_Put(i, MYKEY_EVENT_RELASE, KeyHot.ClickCount[i]);
+                    } else {
+                        //发送单击按键消息
+                        KeyMessage_Put(i, MYKEY_EVENT_CLICK, KeyHot.ClickCount[i]);
                     }
-                    break;
                 }
+                break;
+
+                //支持长按和连续触发
+                case KEYSTATE_PRESS_LR:
+                //仅支持长按
+                case KEYSTATE_PRESS_L:
+                //仅支持连续触发
+                case KEYSTATE_PRESS_R: {
+                    KEY_SET_STATE(i, KEYSTATE_RELASE);
+                    //发送按键松开消息
+                    KeyMessage_Put(i, MYKEY_EVENT_RELASE, KeyHot.ClickCount[i]);
+                }
+                break;
+
+                default: {
+                    KEY_SET_STATE(i, KEYSTATE_RELASE);
+                }
+                break;
             }
         }
-        p = p->Next_Key;
     }
 }
+
+//读取已发布按键的状态并处理
+static void KeyScan_Keys(myKeyTick_t InterVal, const uint32_t *Used)
+{
+    uint32_t attention[MYKEY_SNAPSHOT_WORDS] = {0};
+
+    //读取所有按键状态
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        uint32_t pending = Used[w];
+        while (pending) {
+            int i = w * 32 + __builtin_ctz(pending);
+            if (KeyConf.Adc[i]) {
+                KeyLane.Raw[i] = (KeyAdc_Level(KeyConf.Adc[i] - 1) == KeyConf.AdcLevel[i]);
+            } else if (KeyConf.KeyStatus[i] == NULL) {
+                KeyLane.Raw[i] = (__atomic_load_n(&KeyInputLevel[w], __ATOMIC_ACQUIRE) >> (i % 32)) & 1U;
+            } else {
+                KeyLane.Raw[i] = (KeyConf.KeyStatus[i]() == 1);
+            }
+            pending &= pending - 1;
+        }
+    }
+
+    //稳定的按键只推进计时，其余的逐个处理
+    KeyTimer_Advance(InterVal, Used, attention);
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        uint32_t pending = attention[w] & Used[w];
+        while (pending) {
+            int i = w * 32 + __builtin_ctz(pending);
+            KEY_TRACE_INC(Visited);
+            KeyScan_One(i, InterVal);
+            KeyLane_Update(i);
+            //回调函数中可能注销按键
+            pending &= (pending - 1) & __atomic_load_n(&KeyIndexUsed[w], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void MyKey_Scan(size_t InterVal)
+{
+    myKeyTick_t tick = (InterVal > KEY_TICK_MAX) ? KEY_TICK_MAX : (myKeyTick_t)InterVal;
+    uint32_t used[MYKEY_SNAPSHOT_WORDS];
+
+    //进入扫描之后再读取已发布的按键，与MyKey_Unregister配合保证扫描中使用的按键不会被回收
+    __atomic_store_n(&KeyScanSeq, KeyScanSeq + 1, __ATOMIC_SEQ_CST);
+#if MYKEY_USE_TRACE
+    KeyTrace_Begin(tick);
+#endif
+    //计时内核使用限幅后的tick，累计时间使用实际间隔，与MyKey_GetTime的说明一致
+    KeyTime += InterVal;
+    for (int w = 0; w < MYKEY_SNAPSHOT_WORDS; w++) {
+        used[w] = __atomic_load_n(&KeyIndexUsed[w], __ATOMIC_SEQ_CST);
+    }
+    KeySet_Sync(used);
+
+    //所有按键都空闲时，探测到没有按键按下就不用再读取每个按键
+    KeyProbeFunc probe = __atomic_load_n(&KeyProbe, __ATOMIC_ACQUIRE);
+    if (probe == NULL || !KeyIndex_Idle(used) || KeyInput_Any(used) || probe() == 1) {
+        KeyScan_Keys(tick, used);
+    }
+    KeyState_Commit();
+    KeyDeferred_Flush();
+    KeySink_Flush();
+#if MYKEY_USE_TRACE
+    KeyTrace_End();
+#endif
+    __atomic_store_n(&KeyScanSeq, KeyScanSeq + 1, __ATOMIC_RELEASE);
+}
@@ -3,7 +3,8 @@
  * @author MGDG
  * @brief 注册一个按键，注册时选择按键支持的检测方式，如单击、双击、长按、连续触发、长按时间、连续触发间隔。
  *        按键消息用到了队列驱动。
- *        注意：以下所有接口都是线程不安全的，在实时操作系统中使用这些接口时必须自己加锁保护。
+ *        注意：MyKey_Register、MyKey_Unregister、MyKey_SetInput、MyKey_Snapshot、MyKey_SubRead可以在其它线程中与MyKey_Scan并发调用，
+ *        扫描不会被阻塞；其它接口都是线程不安全的，在实时操作系统中使用这些接口时必须自己加锁保护。
  * @version 0.1
  * @date 2017-09-04
  *
@@ -20,11 +21,68 @@
 extern "C" {
 #endif
 
+#ifndef MYKEY_MAX_KEYS
+#define MYKEY_MAX_KEYS          (32)                            /** 最多可注册的按键个数 */
+#endif
+#ifndef MYKEY_MAX_ADCS
+#define MYKEY_MAX_ADCS          (4)                             /** 最多可创建的模拟按键（电阻分压按键）通道个数 */
+#endif
+#ifndef MYKEY_USE_STATS
+#define MYKEY_USE_STATS         (1)                             /** 是否统计每个按键的运行数据 */
+#endif
+#ifndef MYKEY_TICKS_PER_MS
+#define MYKEY_TICKS_PER_MS      (1)                             /** 计时单位，每ms的计时数。所有时间参数的单位都是计时单位，1表示ms，1000表示us */
+#endif
+#if MYKEY_TICKS_PER_MS > 1
+#define MYKEY_TICK_MAX          (0xFFFFFFFFUL)                  /** 时间参数的最大值，以us计时时约71分钟 */
+#else
+#define MYKEY_TICK_MAX          (0xFFFFUL)                      /** 时间参数的最大值 */
+#endif
+#ifndef MYKEY_USE_GESTURE
+#define MYKEY_USE_GESTURE       (1)                             /** 是否支持手势识别，为0时不占用手势的内存，事件输出也不查手势状态机 */
+#endif
+#ifndef MYKEY_MAX_GESTURES
+#define MYKEY_MAX_GESTURES      (16)                            /** 最多可添加的手势（按键序列）个数，不能超过32 */
+#endif
+#define MYKEY_GESTURE_MAX_STEPS (8)                             /** 一个手势最多的步数 */
+#define MYKEY_HOLD_HIST_NUM     (8)                             /** 按住时间分布的区间个数 */
+#ifndef MYKEY_USE_TRACE
+#define MYKEY_USE_TRACE         (0)                             /** 是否记录每次扫描的耗时，用于导出Chrome trace */
+#endif
+#ifndef MYKEY_TRACE_NUM
+#define MYKEY_TRACE_NUM         (256)                           /** 扫描记录环形缓冲区长度，必须是2的幂 */
+#endif
+#define MYKEY_SNAPSHOT_WORDS    ((MYKEY_MAX_KEYS + 31) / 32)    /** 按键状态位图的长度，单位uint32_t */
+
 #define MYKEY_EVENT_CLICK       ((unsigned char)0x01U)          /** 单击 */
 #define MYKEY_EVENT_DBLCLICK    ((unsigned char)0x02U)          /** 双击 */
 #define MYKEY_EVENT_LONG_PRESS  ((unsigned char)0x04U)          /** 长按 */
 #define MYKEY_EVENT_REPEAT      ((unsigned char)0x08U)          /** 连续触发、重复触发 */
 #define MYKEY_EVENT_RELASE      ((unsigned char)0x10U)          /** 松开 */
+#define MYKEY_EVENT_GESTURE     ((unsigned char)0x20U)          /** 手势，KeyClickCount为手势序号，KeyID为最后一步的按键 */
+#define MYKEY_EVENT_ALL         ((unsigned char)0xFFU)          /** 所有事件，用于订阅过滤 */
+
+/**
+ * @brief 按键表镜像，用于一次装载全部按键。格式为8字节头加每个按键8字节，多字节数据为小端：
+ *        头：'M','K','T','B',版本,0,按键数低字节,按键数高字节
+ *        按键：Mode,Source,Level,0,RepeatSpeed(2字节),LongPressTime(2字节)，时间的单位固定为ms，与MYKEY_TICKS_PER_MS无关
+ *        普通按键的Source为按键状态读取函数表中的序号，Level为MYKEY_IMAGE_DIGITAL；
+ *        模拟按键的Source为模拟按键通道的序号（按创建顺序从0开始），Level为按键对应的区间。
+ *        可以在编译时用下面的宏生成：
+ *        static const uint8_t Image[] = { MYKEY_IMAGE_HEAD(2), MYKEY_IMAGE_KEY(0, 0x1F, 100, 1000), MYKEY_IMAGE_ADC_KEY(0, 1, 0x01, 0, 0) };
+ */
+#define MYKEY_IMAGE_VERSION     (1)
+#define MYKEY_IMAGE_DIGITAL     (0xFF)
+#define MYKEY_IMAGE_SIZE(Num)   (8 + 8 * (Num))                 /** 按键数为Num的镜像大小，单位字节 */
+#define MYKEY_IMAGE_HEAD(Num)   'M', 'K', 'T', 'B', MYKEY_IMAGE_VERSION, 0, (uint8_t)((Num) & 0xFF), (uint8_t)(((Num) >> 8) & 0xFF)
+#define MYKEY_IMAGE_ENTRY(Source, Level, Mode, RepeatSpeed, LongPressTime) \
+    (uint8_t)(Mode), (uint8_t)(Source), (uint8_t)(Level), 0, \
+    (uint8_t)((RepeatSpeed) & 0xFF), (uint8_t)(((RepeatSpeed) >> 8) & 0xFF), \
+    (uint8_t)((LongPressTime) & 0xFF), (uint8_t)(((LongPressTime) >> 8) & 0xFF)
+#define MYKEY_IMAGE_KEY(Source, Mode, RepeatSpeed, LongPressTime) \
+    MYKEY_IMAGE_ENTRY(Source, MYKEY_IMAGE_DIGITAL, Mode, RepeatSpeed, LongPressTime)
+#define MYKEY_IMAGE_ADC_KEY(Adc, Level, Mode, RepeatSpeed, LongPressTime) \
+    MYKEY_IMAGE_ENTRY(Adc, Level, Mode, RepeatSpeed, LongPressTime)
 
 /**
  * @brief 按键句柄
@@ -32,12 +90,94 @@ extern "C" {
  */
 typedef void *MyKeyHandle;
 
+/**
+ * @brief 按键事件订阅者句柄
+ *
+ */
+typedef void *MyKeySubHandle;
+
+/**
+ * @brief 按键运行统计，从注册之后的第一次扫描开始统计
+ *
+ */
+typedef struct {
+    uint32_t Presses;                           /** 消抖后的按下次数 */
+    uint32_t Bounces;                           /** 被消抖滤掉的抖动次数 */
+    uint32_t LongPresses;                       /** 长按次数 */
+    uint32_t Repeats;                           /** 连续触发事件个数 */
+    uint32_t Dropped;                           /** 按键消息队列满被丢掉的事件个数 */
+    uint32_t HoldHist[MYKEY_HOLD_HIST_NUM];     /** 按住时间分布，第0项为小于32ms，第n项为[32ms<<(n-1), 32ms<<n)，最后一项包括更长的 */
+} MyKeyStats_t;
+
+/**
+ * @brief 手势中的一步：指定按键产生EventMask中的任意一个事件
+ *
+ */
+typedef struct {
+    MyKeyHandle Key;                            /** 按键句柄 */
+    unsigned char EventMask;                    /** 事件集合，MYKEY_EVENT_xxx按位或，不能包括MYKEY_EVENT_GESTURE */
+} MyKeyGestureStep_t;
+
 /**
  * @brief 按键状态读取函数，按下返回1，弹起返回0
  *
  */
 typedef int (*KeyStatusFunc)(void);
 
+/**
+ * @brief 按键总探测函数，如所有按键线与的中断脚、或者端口读数与所有按键位的掩码。
+ *        有任意按键按下时返回1，都没有按下时返回0，可以多报但不能漏报
+ *
+ */
+typedef int (*KeyProbeFunc)(void);
+
+/**
+ * @brief 模拟按键通道句柄，一个ADC引脚通过电阻分压连接多个按键
+ *
+ */
+typedef void *MyKeyAdcHandle;
+
+/**
+ * @brief ADC采样函数，返回本次采样值
+ *
+ */
+typedef int (*KeyAdcFunc)(void);
+
+/**
+ * @brief 按键事件回调函数，在MyKey_Scan中调用
+ *
+ */
+typedef void (*KeyEventCallback)(MyKeyHandle KeyID, unsigned char KeyEvent, unsigned char KeyClickCount);
+
+#define MYKEY_CALLBACK_INLINE   (0)     /** 产生事件时立即调用回调函数 */
+#define MYKEY_CALLBACK_DEFERRED (1)     /** 本次扫描产生的事件在扫描结束时按顺序调用回调函数 */
+
+/**
+ * @brief 按键事件输出函数，每产生一个按键事件在MyKey_Scan中调用一次
+ *
+ */
+typedef void (*KeyEventSink)(MyKeyHandle KeyID, unsigned char KeyEvent, unsigned char KeyClickCount, void *Arg);
+
+/**
+ * @brief 按键事件输出函数的扫描结束函数，本次扫描中有事件输出时在MyKey_Scan结束前调用一次，
+ *        用于把一次扫描的多个事件合并通知，如唤醒等待的读者
+ *
+ */
+typedef void (*KeySinkFlushFunc)(void *Arg);
+
+/**
+ * @brief 扫描记录使用的时钟，返回单调递增的时间，单位ns，如clock_gettime(CLOCK_MONOTONIC)
+ *
+ */
+typedef uint64_t (*KeyTraceClockFunc)(void);
+
+/**
+ * @brief 扫描记录导出函数，每次输出一段JSON文本
+ *
+ * @return int 0:success, other:failed，失败时停止导出
+ */
+typedef int (*KeyTraceWriteFunc)(const char *Data, size_t Len, void *Arg);
+
 /**
  * @brief 初始化按键扫描器
  *
@@ -46,39 +186,210 @@ typedef int (*KeyStatusFunc)(void);
 int MyKey_Init(void);
 
 /**
- * @brief 注销按键扫描器
+ * @brief 注销按键扫描器，同时清除所有订阅和事件输出函数。
+ *        之前的订阅句柄读不到新的事件，只能用MyKey_Unsubscribe释放
  *
  * @return int 0:success, other:failed
  */
 int MyKey_Deinit(void);
 
 /**
- * @brief 注册一个按键
+ * @brief 注册一个按键，可以在其它线程中与MyKey_Scan并发调用，下一次扫描开始处理该按键
  *
  * @param Key  按键句柄
  * @param func  按键状态读取函数，按下返回true，弹起返回false
  * @param Mode  按键功能，按键事件集合
- * @param RepeatSpeed  长按时连续触发周期，单位ms
- * @param LongPressTime  长按时间
- * @return int 0:success, other:failed
+ * @param RepeatSpeed  长按时连续触发周期，单位为计时单位（见MYKEY_TICKS_PER_MS），不能超过MYKEY_TICK_MAX
+ * @param LongPressTime  长按时间，单位为计时单位（见MYKEY_TICKS_PER_MS），不能超过MYKEY_TICK_MAX
+ * @return int 0:success, other:failed（按键已注册、按键数超过MYKEY_MAX_KEYS或者时间超出范围）
  */
 int MyKey_Register(MyKeyHandle *Key, KeyStatusFunc func, unsigned char Mode, size_t RepeatSpeed, size_t LongPressTime);
 
 /**
- * @brief 卸载一个按键
+ * @brief 创建一个模拟按键通道。每次扫描只采样一次，采样值按门限表划分为Num+1个区间：
+ *        区间k为[Thresholds[k-1], Thresholds[k])，区间0没有下限，区间Num没有上限。
+ *        采样值在当前区间上下扩展Hysteresis的范围内时保持当前区间，防止在门限附近来回跳变。
+ *        没有按键按下时采样值所在的区间不注册按键即可。
+ *
+ * @param Adc  模拟按键通道句柄
+ * @param func  ADC采样函数
+ * @param Thresholds  门限表，必须升序排列，只保存指针，使用期间必须一直有效
+ * @param Num  门限个数，不能超过254
+ * @param Hysteresis  回差
+ * @return int 0:success, other:failed
+ */
+int MyKey_AdcCreate(MyKeyAdcHandle *Adc, KeyAdcFunc func, const uint16_t *Thresholds, size_t Num, uint16_t Hysteresis);
+
+/**
+ * @brief 删除一个模拟按键通道，必须先卸载该通道上的所有按键
+ *
+ * @param Adc  模拟按键通道句柄
+ * @return int 0:success, other:failed
+ */
+int MyKey_AdcDelete(MyKeyAdcHandle *Adc);
+
+/**
+ * @brief 注册一个模拟按键，采样值落在区间Level时认为按下，之后的消抖和按键检测与普通按键相同
+ *
+ * @param Key  按键句柄
+ * @param Adc  模拟按键通道句柄
+ * @param Level  按键对应的区间，0~Num
+ * @param Mode  按键功能，按键事件集合
+ * @param RepeatSpeed  长按时连续触发周期，单位为计时单位（见MYKEY_TICKS_PER_MS），不能超过MYKEY_TICK_MAX
+ * @param LongPressTime  长按时间，单位为计时单位（见MYKEY_TICKS_PER_MS），不能超过MYKEY_TICK_MAX
+ * @return int 0:success, other:failed
+ */
+int MyKey_RegisterAdc(MyKeyHandle *Key, MyKeyAdcHandle Adc, size_t Level, unsigned char Mode, size_t RepeatSpeed, size_t LongPressTime);
+
+/**
+ * @brief 注册一个输入按键，按键状态不由判断函数读取，而是由MyKey_SetInput写入，
+ *        适用于按键状态以事件形式到达的场合，如Linux输入设备。之后的消抖和按键检测与普通按键相同
+ *
+ * @param Key  按键句柄
+ * @param Mode  按键功能，按键事件集合
+ * @param RepeatSpeed  长按时连续触发周期，单位为计时单位（见MYKEY_TICKS_PER_MS），不能超过MYKEY_TICK_MAX
+ * @param LongPressTime  长按时间，单位为计时单位（见MYKEY_TICKS_PER_MS），不能超过MYKEY_TICK_MAX
+ * @return int 0:success, other:failed
+ */
+int MyKey_RegisterInput(MyKeyHandle *Key, unsigned char Mode, size_t RepeatSpeed, size_t LongPressTime);
+
+/**
+ * @brief 写入输入按键的状态，下一次MyKey_Scan读取。可以在其它线程中调用
+ *
+ * @param Key  MyKey_RegisterInput注册的按键句柄
+ * @param Level  1表示按下，其它表示松开
+ * @return int 0:success, other:failed
+ */
+int MyKey_SetInput(MyKeyHandle Key, int Level);
+
+/**
+ * @brief 设置按键总探测函数。设置之后如果探测到没有按键按下，并且所有按键都处于松开状态、没有计时器在运行，
+ *        MyKey_Scan只调用一次探测函数就返回，不再读取每个按键的状态。探测函数必须覆盖所有按键，包括模拟按键
+ *
+ * @param Probe  探测函数，NULL表示不使用探测函数
+ * @return int 0:success, other:failed
+ */
+int MyKey_SetProbe(KeyProbeFunc Probe);
+
+/**
+ * @brief 设置按键事件回调函数。设置之后该按键的事件由MyKey_Scan直接调用回调函数处理，不再放入按键消息队列，
+ *        MyKey_Read读不到该按键的事件，订阅者和事件输出函数不受影响。
+ *        回调函数在MyKey_Scan的上下文中执行，必须尽快返回，可以调用MyKey_Snapshot。
+ *
+ * @param Key  按键句柄
+ * @param Callback  回调函数，NULL表示取消回调，恢复使用按键消息队列
+ * @param CallMode  MYKEY_CALLBACK_INLINE或者MYKEY_CALLBACK_DEFERRED
+ * @return int 0:success, other:failed
+ */
+int MyKey_SetCallback(MyKeyHandle Key, KeyEventCallback Callback, int CallMode);
+
+/**
+ * @brief 卸载一个按键。可以在其它线程或者按键回调函数中调用，
+ *        正在进行的扫描结束之后该按键占用的位置才会被新注册的按键复用
  *
  * @param Key  按键句柄
  * @return int 0:success, other:failed
  */
 int MyKey_Unregister(MyKeyHandle *Key);
 
+/**
+ * @brief 从按键表镜像一次装载所有按键，按键表必须是空的（MyKey_Init之后还没有注册按键），
+ *        模拟按键通道必须先按镜像中的序号创建好。镜像中第n个按键的序号为n。
+ *        先检查整个镜像，有错误（包括与MyKey_Register相同的检查：两个按键使用同一个读取函数，
+ *        或者同一个模拟按键通道的同一个区间）时不会注册任何按键
+ *
+ * @param Image  按键表镜像
+ * @param Size  镜像大小，单位字节
+ * @param Sources  按键状态读取函数表，镜像中普通按键的Source是该表的序号
+ * @param SourceNum  按键状态读取函数表长度
+ * @param Keys  按键句柄，按镜像中的顺序输出，可以为NULL
+ * @return int 装载的按键个数，小于0表示失败
+ */
+int MyKey_LoadImage(const uint8_t *Image, size_t Size, const KeyStatusFunc *Sources, size_t SourceNum, MyKeyHandle *Keys);
+
+/**
+ * @brief 把当前注册的所有按键按序号顺序保存为按键表镜像，回调函数不保存。
+ *        MyKey_RegisterInput注册的输入按键不保存，由注册它的模块（如MyKeyFd）重新注册
+ *        镜像中的时间单位为ms，MYKEY_TICKS_PER_MS大于1时连续触发周期和长按时间必须是整数ms
+ *
+ * @param Image  镜像缓冲区，NULL表示只计算镜像大小
+ * @param Size  缓冲区大小，单位字节
+ * @param Sources  按键状态读取函数表，普通按键的读取函数必须在表中
+ * @param SourceNum  按键状态读取函数表长度
+ * @return int 镜像大小，小于0表示失败（缓冲区太小、读取函数不在表中或者时间不是整数ms）
+ */
+int MyKey_SaveImage(uint8_t *Image, size_t Size, const KeyStatusFunc *Sources, size_t SourceNum);
+
+/**
+ * @brief 获取按键的序号，序号在按键注册期间不变，注销后会被后注册的按键复用
+ *
+ * @param Key  按键句柄
+ * @return int 0~MYKEY_MAX_KEYS-1:按键序号, other:failed
+ */
+int MyKey_GetIndex(MyKeyHandle Key);
+
+/**
+ * @brief 读取一个按键的运行统计，不需要加锁，与MyKey_Scan并发调用时得到的是一致的统计数据
+ *
+ * @param Key  按键句柄
+ * @param Stats  运行统计
+ * @return int 0:success, other:failed（按键无效或者MYKEY_USE_STATS为0）
+ */
+int MyKey_GetStats(MyKeyHandle Key, MyKeyStats_t *Stats);
+
+/**
+ * @brief 开始记录每次扫描的开始时间、耗时、逐个处理的按键数、调用的回调函数数和产生的事件数，
+ *        记录保存在长度为MYKEY_TRACE_NUM的环形缓冲区中，写满后覆盖最旧的记录
+ *
+ * @param Clock  时钟函数，NULL表示停止记录
+ * @return int 0:success, other:failed（MYKEY_USE_TRACE为0）
+ */
+int MyKey_TraceStart(KeyTraceClockFunc Clock);
+
+/**
+ * @brief 把缓冲区中的扫描记录按Chrome trace（Perfetto可以直接打开）的JSON格式导出，从最旧的记录开始，
+ *        不会清除记录。可以在其它线程中与MyKey_Scan并发调用，导出期间被覆盖的记录会被跳过
+ *
+ * @param Write  导出函数
+ * @param Arg  导出函数的参数
+ * @return int 导出的记录个数，小于0表示失败
+ */
+int MyKey_TraceExport(KeyTraceWriteFunc Write, void *Arg);
+
+/**
+ * @brief 获取所有按键消抖后的按下状态，按键序号为n的状态在Bitmap[n / 32]的第(n % 32)位，1表示按下。
+ *        不需要加锁，与MyKey_Scan并发调用时得到的是某一次扫描完成之后的一致状态。
+ *        可以在回调函数和事件输出函数中调用：内联回调和事件输出函数中得到的是上一次扫描完成之后的状态，
+ *        延迟回调和扫描结束函数中得到的是本次扫描完成之后的状态。
+ *
+ * @param Bitmap  按键状态位图，长度为MYKEY_SNAPSHOT_WORDS
+ */
+void MyKey_Snapshot(uint32_t *Bitmap);
+
 /**
  * @brief 按键扫描,需要周期调用
  *
- * @param InterVal  调用间隔，单位ms
+ * @param InterVal  调用间隔，单位为计时单位（见MYKEY_TICKS_PER_MS）
  */
 void MyKey_Scan(size_t InterVal);
 
+/**
+ * @brief 获取扫描累计时间，即所有MyKey_Scan的InterVal之和，可以作为按键事件的时间戳。
+ *        只能在MyKey_Scan的上下文中调用，如回调函数和事件输出函数中
+ *
+ * @return uint64_t 扫描累计时间，单位为计时单位
+ */
+uint64_t MyKey_GetTime(void);
+
+/**
+ * @brief 所有按键是否都处于松开状态、没有计时器在运行并且没有按下的输入按键。
+ *        空闲时不调用MyKey_Scan也不会丢失按键事件，只有按键判断函数读取的按键需要继续扫描才能发现按下。
+ *        只能在调用MyKey_Scan的线程中调用
+ *
+ * @return int 1:空闲, 0:不空闲
+ */
+int MyKey_Idle(void);
+
 /**
  * @brief 打印出已注册的按键ID
  *
@@ -95,6 +406,99 @@ void MyKey_PrintKeyInfo(void);
  */
 int MyKey_Read(MyKeyHandle *KeyID, unsigned char *KeyEvent, unsigned char *KeyClickCount);
 
+/**
+ * @brief 创建一个按键事件订阅者。
+ *        所有订阅者共享同一个广播环形缓冲区，事件只存储一份，每个订阅者有独立的读指针，
+ *        只能读到订阅之后产生的事件。读取不会影响MyKey_Read和其它订阅者。
+ *        每个订阅者只能在一个线程中读取，读取与MyKey_Scan之间不需要加锁。
+ *        读取太慢时最旧的事件会被覆盖，订阅者会跳过被覆盖的事件。
+ *
+ * @param Sub 订阅者句柄
+ * @param KeyID 只接收该按键的事件，NULL表示接收所有按键的事件
+ * @param EventMask 接收的事件集合，MYKEY_EVENT_xxx按位或，MYKEY_EVENT_ALL表示所有事件
+ * @return int 0:success, other:failed
+ */
+int MyKey_Subscribe(MyKeySubHandle *Sub, MyKeyHandle KeyID, unsigned char EventMask);
+
+/**
+ * @brief 删除一个按键事件订阅者
+ *
+ * @param Sub 订阅者句柄
+ * @return int 0:success, other:failed
+ */
+int MyKey_Unsubscribe(MyKeySubHandle *Sub);
+
+/**
+ * @brief 订阅者读取一个符合过滤条件的按键消息
+ *
+ * @param Sub 订阅者句柄
+ * @param KeyID 按键句柄
+ * @param KeyEvent 按键事件，单击、双击还是长按等等
+ * @param KeyClickCount 按键点击次数
+ * @return int 0:success, other:failed
+ */
+int MyKey_SubRead(MyKeySubHandle Sub, MyKeyHandle *KeyID, unsigned char *KeyEvent, unsigned char *KeyClickCount);
+
+/**
+ * @brief 添加一个按键事件输出函数，用于把按键事件转发到共享内存、日志等，输出函数中不能阻塞
+ *
+ * @param Sink 输出函数
+ * @param Arg 输出函数的参数
+ * @return int 0:success, other:failed
+ */
+int MyKey_AddSink(KeyEventSink Sink, void *Arg);
+
+/**
+ * @brief 删除一个按键事件输出函数
+ *
+ * @param Sink 输出函数
+ * @param Arg 输出函数的参数，与添加时一致
+ * @return int 0:success, other:failed
+ */
+int MyKey_RemoveSink(KeyEventSink Sink, void *Arg);
+
+/**
+ * @brief 设置按键事件输出函数的扫描结束函数，不能阻塞
+ *
+ * @param Sink 输出函数
+ * @param Arg 输出函数的参数，与添加时一致
+ * @param Flush 扫描结束函数，NULL表示不使用
+ * @return int 0:success, other:failed
+ */
+int MyKey_SetSinkFlush(KeyEventSink Sink, void *Arg, KeySinkFlushFunc Flush);
+
+/**
+ * @brief 添加一个手势（按键序列），如"按键1单击后长按"、"按键1、按键2、按键1依次单击"。
+ *        所有手势用到的按键事件组成一个共同的事件集合，集合之外的事件被忽略；集合之内的任何事件
+ *        对所有手势都算一步，不满足某个手势下一步的事件会打断该手势正在进行的匹配（该事件本身可以
+ *        作为它的第一步），所以添加手势可能改变其它手势的匹配结果。参与匹配的事件必须依次满足每一步，
+ *        相邻两步的间隔不能超过Timeout，间隔从上一个参与匹配的事件算起。
+ *        匹配时产生MYKEY_EVENT_GESTURE事件，与普通事件一样输出，一个事件同时完成多个手势时
+ *        按手势序号从小到大各产生一个。
+ *        添加之后需要调用MyKey_GestureCompile才生效
+ *
+ * @param Steps 手势的每一步
+ * @param Num 步数，1~MYKEY_GESTURE_MAX_STEPS
+ * @param Timeout 相邻两步的最大间隔，单位为计时单位，0表示不限制，不能超过MYKEY_TICK_MAX
+ * @return int 手势序号，0~MYKEY_MAX_GESTURES-1，小于0表示失败（参数无效、手势已满或者MYKEY_USE_GESTURE为0）
+ */
+int MyKey_GestureAdd(const MyKeyGestureStep_t *Steps, size_t Num, size_t Timeout);
+
+/**
+ * @brief 把所有手势编译为一个确定有限状态机，之后每个参与匹配的事件只需查一次符号表、在不同的间隔门限中
+ *        二分查找间隔区间（门限个数不超过MYKEY_MAX_GESTURES）、查一次状态转移表，与手势的步数和状态数无关。
+ *        不能与MyKey_Scan并发调用
+ *
+ * @return int 状态机的状态数，小于0表示失败（内存不足、状态数太多或者MYKEY_USE_GESTURE为0）
+ */
+int MyKey_GestureCompile(void);
+
+/**
+ * @brief 删除所有手势和状态机，不能与MyKey_Scan并发调用
+ *
+ */
+void MyKey_GestureClear(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,341 @@
+/**
+  * @file       MyKeyFd.c
+  * @author     mgdg
+  * @brief      文件描述符按键输入
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     按键状态以事件记录的形式从文件描述符读取，如evdev输入设备、GPIO字符设备或者模拟器的管道。
+  *             每个(fd, code)对应一个MyKey_RegisterInput注册的输入按键，消抖和按键检测与普通按键相同。
+  *             用epoll等待输入，每次唤醒每个fd只读一次，一次读出多条记录；
+  *             按记录的时间戳先把MyKey_Scan推进到边沿发生的时刻再写入按键状态，消抖计时不受唤醒延迟影响。
+  *             所有按键空闲时一直等待输入，不再周期扫描。
+  *             MyKeyFd_Run中调用MyKey_Scan，使用本模块时不能在其它地方调用MyKey_Scan。
+  *             仅支持Linux。
+  */
+
+#include "MyKeyFd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <linux/input.h>
+#include <linux/gpio.h>
+
+#define debug_i(format,...)             /*printf(format"\n",##__VA_ARGS__)*/
+#define MYKEYFD_MAX_FDS                 (8)     /*最多可添加的fd个数*/
+#define MYKEYFD_NS_PER_TICK             (1000000ULL / MYKEY_TICKS_PER_MS)
+
+/*一个输入fd，缓冲区保存上次读到的不完整记录*/
+struct myKeyFdSource {
+    int                 fd;             /*文件描述符，-1表示未使用*/
+    int                 format;         /*记录格式*/
+    size_t              size;           /*单条记录大小(单位 字节)*/
+    size_t              left;           /*缓冲区中不完整记录的字节数*/
+    union {
+        struct input_event          input[MYKEYFD_BATCH];
+        struct gpio_v2_line_event   gpio[MYKEYFD_BATCH];
+    } buffer;
+};
+
+/*一个按键对应的(fd, code)*/
+struct myKeyFdKey {
+    MyKeyHandle         key;            /*按键句柄，NULL表示未使用*/
+    int                 fd;             /*文件描述符*/
+    unsigned int        code;           /*按键码或者GPIO偏移*/
+    int                 level;          /*已写入的按键状态*/
+};
+
+/*一次唤醒读到的边沿*/
+struct myKeyFdEdge {
+    uint64_t            time;           /*时间戳(单位 ns)*/
+    uint16_t            key;            /*按键在keys中的位置*/
+    uint8_t             level;          /*1表示按下*/
+};
+
+struct myKeyFd {
+    int                 epfd;           /*epoll句柄*/
+    clockid_t           clock;          /*时间戳使用的时钟*/
+    uint64_t            base;           /*创建时的时间(单位 ns)*/
+    uint64_t            ticks;          /*创建之后已经扫描的时间(单位 计时单位)*/
+    uint64_t            step;           /*不空闲时每次扫描的间隔(单位 计时单位)*/
+    struct myKeyFdSource sources[MYKEYFD_MAX_FDS];
+    struct myKeyFdKey   keys[MYKEY_MAX_KEYS];
+    struct myKeyFdEdge  edges[MYKEYFD_MAX_FDS * MYKEYFD_BATCH];
+    size_t              edge_num;
+};
+
+static uint64_t myKeyFd_Now(const struct myKeyFd *input)
+{
+    struct timespec ts;
+    clock_gettime(input->clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+//把扫描推进到时间time。不空闲时按扫描周期逐次扫描，与周期调用MyKey_Scan的结果相同；
+//空闲时一次跳过，超过MYKEY_TICK_MAX的间隔分多次扫描，保证扫描累计时间连续
+static void myKeyFd_Advance(struct myKeyFd *input, uint64_t time)
+{
+    if (time <= input->base) {
+        return;
+    }
+    uint64_t target = (time - input->base) / MYKEYFD_NS_PER_TICK;
+    while (input->ticks < target) {
+        uint64_t step = target - input->ticks;
+        uint64_t max = MyKey_Idle() ? MYKEY_TICK_MAX : input->step;
+        if (step > max) {
+            step = max;
+        }
+        MyKey_Scan((size_t)step);
+        input->ticks += step;
+    }
+}
+
+static void myKeyFd_SetLevel(struct myKeyFdKey *k, int level)
+{
+    if (k->level != level) {
+        k->level = level;
+        MyKey_SetInput(k->key, level);
+    }
+}
+
+static struct myKeyFdSource *myKeyFd_FindSource(struct myKeyFd *input, int fd)
+{
+    for (int i = 0; i < MYKEYFD_MAX_FDS; i++) {
+        if (input->sources[i].fd == fd) {
+            return &input->sources[i];
+        }
+    }
+    return NULL;
+}
+
+//移除fd，该fd上按下的按键全部松开
+static void myKeyFd_CloseSource(struct myKeyFd *input, struct myKeyFdSource *src)
+{
+    epoll_ctl(input->epfd, EPOLL_CTL_DEL, src->fd, NULL);
+    for (int i = 0; i < MYKEY_MAX_KEYS; i++) {
+        if (input->keys[i].key != NULL && input->keys[i].fd == src->fd) {
+            myKeyFd_SetLevel(&input->keys[i], 0);
+        }
+    }
+    src->fd = -1;
+    src->left = 0;
+}
+
+static void myKeyFd_AddEdge(struct myKeyFd *input, int fd, unsigned int code, int level, uint64_t time, uint64_t now)
+{
+    for (int i = 0; i < MYKEY_MAX_KEYS; i++) {
+        struct myKeyFdKey *k = &input->keys[i];
+        if (k->key != NULL && k->fd == fd && k->code == code) {
+            struct myKeyFdEdge *e = &input->edges[input->edge_num++];
+            //时间戳为0或者晚于当前时间（时钟不一致）时使用读到时的时间
+            e->time = (time == 0 || time > now) ? now : time;
+            e->key = (uint16_t)i;
+            e->level = (uint8_t)level;
+            return;
+        }
+    }
+}
+
+//读一次fd，把完整的记录转换为边沿，返回-1表示fd已经关闭
+static int myKeyFd_ReadSource(struct myKeyFd *input, struct myKeyFdSource *src, uint64_t now)
+{
+    ssize_t n = read(src->fd, (char *)&src->buffer + src->left, sizeof(src->buffer) - src->left);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+        return -1;
+    }
+    if (n < 0) {
+        return 0;
+    }
+    size_t total = src->left + (size_t)n;
+    size_t num = total / src->size;
+    for (size_t i = 0; i < num; i++) {
+        if (src->format == MYKEYFD_FORMAT_INPUT) {
+            const struct input_event *ev = &src->buffer.input[i];
+            if (ev->type == EV_KEY) {
+                uint64_t time = (uint64_t)ev->input_event_sec * 1000000000ULL + (uint64_t)ev->input_event_usec * 1000ULL;
+                myKeyFd_AddEdge(input, src->fd, ev->code, (ev->value != 0), time, now);
+            }
+        } else {
+            const struct gpio_v2_line_event *ev = &src->buffer.gpio[i];
+            myKeyFd_AddEdge(input, src->fd, ev->offset, (ev->id == GPIO_V2_LINE_EVENT_RISING_EDGE), ev->timestamp_ns, now);
+        }
+    }
+    src->left = total - num * src->size;
+    if (src->left) {
+        memmove(&src->buffer, (char *)&src->buffer + num * src->size, src->left);
+    }
+    return 0;
+}
+
+myKeyFdHandle_t MyKeyFd_Create(clockid_t clock)
+{
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0) {
+        return NULL;
+    }
+    struct myKeyFd *input = calloc(1, sizeof(struct myKeyFd));
+    if (NULL == input) {
+        return NULL;
+    }
+    input->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (input->epfd < 0) {
+        debug_i("epoll_create1 failed,errno=%d", errno);
+        free(input);
+        return NULL;
+    }
+    for (int i = 0; i < MYKEYFD_MAX_FDS; i++) {
+        input->sources[i].fd = -1;
+    }
+    input->clock = clock;
+    input->base = myKeyFd_Now(input);
+    input->ticks = 0;
+    return input;
+}
+
+void MyKeyFd_Delete(myKeyFdHandle_t input)
+{
+    if (NULL == input) {
+        return;
+    }
+    for (int i = 0; i < MYKEY_MAX_KEYS; i++) {
+        if (input->keys[i].key != NULL) {
+            MyKey_Unregister(&input->keys[i].key);
+        }
+    }
+    close(input->epfd);
+    free(input);
+}
+
+int MyKeyFd_AddFd(myKeyFdHandle_t input, int fd, int format)
+{
+    if ((NULL == input) || (fd < 0) || ((format != MYKEYFD_FORMAT_INPUT) && (format != MYKEYFD_FORMAT_GPIO))
+            || (myKeyFd_FindSource(input, fd) != NULL)) {
+        return -1;
+    }
+    struct myKeyFdSource *src = myKeyFd_FindSource(input, -1);
+    if (NULL == src) {
+        return -1;
+    }
+    int flags = fcntl(fd, F_GETFL);
+    if ((flags < 0) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0)) {
+        return -1;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = src;
+    if (epoll_ctl(input->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        debug_i("epoll_ctl add %d failed,errno=%d", fd, errno);
+        return -1;
+    }
+    src->fd = fd;
+    src->format = format;
+    src->size = (format == MYKEYFD_FORMAT_INPUT) ? sizeof(struct input_event) : sizeof(struct gpio_v2_line_event);
+    src->left = 0;
+    return 0;
+}
+
+int MyKeyFd_RemoveFd(myKeyFdHandle_t input, int fd)
+{
+    if ((NULL == input) || (fd < 0)) {
+        return -1;
+    }
+    struct myKeyFdSource *src = myKeyFd_FindSource(input, fd);
+    if (NULL == src) {
+        return -1;
+    }
+    myKeyFd_CloseSource(input, src);
+    return 0;
+}
+
+int MyKeyFd_Register(myKeyFdHandle_t input, MyKeyHandle *Key, int fd, unsigned int code, unsigned char Mode, size_t RepeatSpeed, size_t LongPressTime)
+{
+    if ((NULL == input) || (NULL == Key) || (fd < 0)) {
+        return -1;
+    }
+    struct myKeyFdKey *slot = NULL;
+    for (int i = 0; i < MYKEY_MAX_KEYS; i++) {
+        struct myKeyFdKey *k = &input->keys[i];
+        if (k->key == NULL) {
+            if (slot == NULL) {
+                slot = k;
+            }
+        } else if (k->fd == fd && k->code == code) {
+            return -1;
+        }
+    }
+    if ((NULL == slot) || (MyKey_RegisterInput(Key, Mode, RepeatSpeed, LongPressTime) != 0)) {
+        return -1;
+    }
+    slot->key = *Key;
+    slot->fd = fd;
+    slot->code = code;
+    slot->level = 0;
+    return 0;
+}
+
+int MyKeyFd_Unregister(myKeyFdHandle_t input, MyKeyHandle *Key)
+{
+    if ((NULL == input) || (NULL == Key) || (NULL == *Key)) {
+        return -1;
+    }
+    for (int i = 0; i < MYKEY_MAX_KEYS; i++) {
+        if (input->keys[i].key == *Key) {
+            if (MyKey_Unregister(Key) != 0) {
+                return -1;
+            }
+            input->keys[i].key = NULL;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int MyKeyFd_Run(myKeyFdHandle_t input, int interval, int timeout_ms)
+{
+    struct epoll_event events[MYKEYFD_MAX_FDS];
+    if ((NULL == input) || (interval <= 0)) {
+        return -1;
+    }
+    int wait = timeout_ms;
+    input->step = (uint64_t)interval * MYKEY_TICKS_PER_MS;
+    if (!MyKey_Idle()) {
+        //距离下一次扫描的时间
+        uint64_t next = input->base + (input->ticks + input->step) * MYKEYFD_NS_PER_TICK;
+        uint64_t now = myKeyFd_Now(input);
+        wait = (next > now) ? (int)((next - now + 999999ULL) / 1000000ULL) : 0;
+    }
+    int n = epoll_wait(input->epfd, events, MYKEYFD_MAX_FDS, wait);
+    if (n < 0 && errno != EINTR) {
+        return -1;
+    }
+
+    uint64_t now = myKeyFd_Now(input);
+    input->edge_num = 0;
+    for (int i = 0; i < n; i++) {
+        struct myKeyFdSource *src = (struct myKeyFdSource *)events[i].data.ptr;
+        if (myKeyFd_ReadSource(input, src, now) != 0) {
+            myKeyFd_CloseSource(input, src);
+        }
+    }
+
+    //不同fd的边沿按时间排序，一次唤醒的边沿很少，直接插入排序
+    for (size_t i = 1; i < input->edge_num; i++) {
+        struct myKeyFdEdge e = input->edges[i];
+        size_t j = i;
+        while (j > 0 && input->edges[j - 1].time > e.time) {
+            input->edges[j] = input->edges[j - 1];
+            j--;
+        }
+        input->edges[j] = e;
+    }
+    for (size_t i = 0; i < input->edge_num; i++) {
+        myKeyFd_Advance(input, input->edges[i].time);
+        myKeyFd_SetLevel(&input->keys[input->edges[i].key], input->edges[i].level);
+    }
+    myKeyFd_Advance(input, now);
+    return (int)input->edge_num;
+}
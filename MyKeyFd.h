@@ -0,0 +1,119 @@
+/**
+  * @file       MyKeyFd.h
+  * @author     mgdg
+  * @brief      文件描述符按键输入
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     按键状态以事件记录的形式从文件描述符读取，如evdev输入设备、GPIO字符设备或者模拟器的管道。
+  *             每个(fd, code)对应一个MyKey_RegisterInput注册的输入按键，消抖和按键检测与普通按键相同。
+  *             用epoll等待输入，每次唤醒每个fd只读一次，一次读出多条记录；
+  *             按记录的时间戳先把MyKey_Scan推进到边沿发生的时刻再写入按键状态，消抖计时不受唤醒延迟影响。
+  *             所有按键空闲时一直等待输入，不再周期扫描。
+  *             MyKeyFd_Run中调用MyKey_Scan，使用本模块时不能在其它地方调用MyKey_Scan。
+  *             仅支持Linux。
+  */
+
+#ifndef __MYKEYFD_H
+#define __MYKEYFD_H
+
+#include <stddef.h>
+#include <time.h>
+#include "MyKeyDrive.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*记录格式*/
+#define MYKEYFD_FORMAT_INPUT            (0)     /*struct input_event，只处理EV_KEY，code为按键码，value非0表示按下*/
+#define MYKEYFD_FORMAT_GPIO             (1)     /*struct gpio_v2_line_event，code为GPIO偏移，上升沿表示按下*/
+
+/*每个fd每次最多读取的记录数*/
+#ifndef MYKEYFD_BATCH
+#define MYKEYFD_BATCH                   (64)
+#endif
+
+/*文件描述符输入句柄*/
+typedef struct myKeyFd *myKeyFdHandle_t;
+
+/**
+  * @brief  创建文件描述符输入，需要在MyKey_Init之后调用
+  * @param  clock：记录时间戳使用的时钟，如CLOCK_MONOTONIC，所有fd的时间戳必须使用同一个时钟
+  *
+  * @return myKeyFdHandle_t：输入句柄，失败返回NULL
+  * @remark evdev设备默认使用CLOCK_REALTIME，可以用EVIOCSCLOCKID改为CLOCK_MONOTONIC；
+  *         GPIO字符设备默认使用CLOCK_MONOTONIC。时间戳为0的记录使用读到时的时间
+  */
+myKeyFdHandle_t MyKeyFd_Create(clockid_t clock);
+
+/**
+  * @brief  删除文件描述符输入，注销所有通过它注册的按键，不关闭fd
+  * @param  input：输入句柄
+  *
+  * @return void
+  * @remark
+  */
+void MyKeyFd_Delete(myKeyFdHandle_t input);
+
+/**
+  * @brief  添加一个输入fd
+  * @param  input：输入句柄
+  * @param  fd：文件描述符，会被设置为非阻塞
+  * @param  format：记录格式，MYKEYFD_FORMAT_INPUT或者MYKEYFD_FORMAT_GPIO
+  *
+  * @return int：0:success, other:failed
+  * @remark fd被关闭（读到文件结束或者挂断）时自动移除，该fd上按下的按键全部松开
+  */
+int MyKeyFd_AddFd(myKeyFdHandle_t input, int fd, int format);
+
+/**
+  * @brief  移除一个输入fd，该fd上按下的按键全部松开，不注销按键也不关闭fd
+  * @param  input：输入句柄
+  * @param  fd：文件描述符
+  *
+  * @return int：0:success, other:failed
+  * @remark
+  */
+int MyKeyFd_RemoveFd(myKeyFdHandle_t input, int fd);
+
+/**
+  * @brief  注册一个按键，fd上code对应的记录改变按键状态
+  * @param  input：输入句柄
+  * @param  *Key：按键句柄
+  * @param  fd：文件描述符，可以在MyKeyFd_AddFd之前注册
+  * @param  code：按键码或者GPIO偏移
+  * @param  Mode：按键功能，按键事件集合
+  * @param  RepeatSpeed：长按时连续触发周期，单位为计时单位（见MYKEY_TICKS_PER_MS）
+  * @param  LongPressTime：长按时间，单位为计时单位（见MYKEY_TICKS_PER_MS）
+  *
+  * @return int：0:success, other:failed
+  * @remark 按键事件的输出方式与普通按键相同
+  */
+int MyKeyFd_Register(myKeyFdHandle_t input, MyKeyHandle *Key, int fd, unsigned int code, unsigned char Mode, size_t RepeatSpeed, size_t LongPressTime);
+
+/**
+  * @brief  注销一个按键
+  * @param  input：输入句柄
+  * @param  *Key：按键句柄
+  *
+  * @return int：0:success, other:failed
+  * @remark
+  */
+int MyKeyFd_Unregister(myKeyFdHandle_t input, MyKeyHandle *Key);
+
+/**
+  * @brief  等待一次输入并扫描按键
+  * @param  input：输入句柄
+  * @param  interval：有按键不空闲时的扫描周期，单位ms
+  * @param  timeout_ms：所有按键空闲时的最长等待时间，单位ms，小于0表示一直等待
+  *
+  * @return int：本次处理的按键记录数，出错返回-1
+  * @remark 需要循环调用。还有MyKey_Register注册的按键时timeout_ms不能小于0，否则发现不了这些按键按下
+  */
+int MyKeyFd_Run(myKeyFdHandle_t input, int interval, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,362 @@
+/**
+  * @file       MyKeyLog.c
+  * @author     mgdg
+  * @brief      按键事件二进制日志
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     把MyKey_Scan产生的每个按键事件以定长记录追加到文件中，用于长时间记录按键输入。
+  *             文件由固定大小的块组成，块头保存第一条记录的绝对时间，块内记录只保存与前一条记录的时间差。
+  *             写入先缓存在内存中，使用两个块交替缓存，扫描中不写文件，调用MyKeyLog_Flush时才写文件。
+  *             读取时把文件映射到内存，可以顺序遍历，也可以按时间二分查找。
+  *             仅支持Linux。
+  */
+
+#include "MyKeyLog.h"
+#include "MyKeyDrive.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define debug_i(format,...)             /*printf(format"\n",##__VA_ARGS__)*/
+#define MYKEYLOG_MAGIC                  (0x4D4B4C47U)       /*"MKLG"*/
+#define MYKEYLOG_VERSION                (1U)
+#define MYKEYLOG_BLOCK_SIZE             (4096U)             /*块大小，文件头也占用一个块*/
+
+/*文件头，位于第一个块的开始*/
+struct myKeyLogHeader {
+    uint32_t            magic;
+    uint32_t            version;
+    uint32_t            block_size;     /*块大小(单位 字节)*/
+    uint32_t            record_size;    /*单条记录大小(单位 字节)*/
+    uint32_t            ticks_per_ms;   /*时间单位，与MYKEY_TICKS_PER_MS相同*/
+    uint32_t            reserved[3];
+};
+
+/*块内的一条记录*/
+struct myKeyLogRecord {
+    uint32_t            delta;          /*与前一条记录的时间差，块内第一条记录为0*/
+    uint16_t            key;            /*按键序号*/
+    uint8_t             event;          /*按键事件*/
+    uint8_t             count;          /*按键次数计数*/
+};
+
+#define MYKEYLOG_RECORD_NUM             ((MYKEYLOG_BLOCK_SIZE - 16U) / sizeof(struct myKeyLogRecord))
+
+/*一个块，块头之后紧跟记录*/
+struct myKeyLogBlock {
+    uint64_t            base;           /*块内第一条记录的时间*/
+    uint32_t            num;            /*块内记录个数*/
+    uint32_t            reserved;
+    struct myKeyLogRecord records[MYKEYLOG_RECORD_NUM];
+};
+
+struct myKeyLog {
+    int                 fd;
+    off_t               block_pos;      /*当前块在文件中的位置*/
+    off_t               full_pos;       /*写满等待写入文件的块在文件中的位置*/
+    uint64_t            offset;         /*记录时间 = MyKey_GetTime() + offset*/
+    uint64_t            last;           /*上一条记录的时间*/
+    uint32_t            dropped;        /*两个块都写满时丢弃的记录数*/
+    bool                error;          /*写文件失败*/
+    bool                full;           /*另一个块已经写满，等待MyKeyLog_Flush写入文件*/
+    uint8_t             cur;            /*正在写的块*/
+    struct myKeyLogBlock block[2];      /*交替使用的块缓存*/
+};
+
+struct myKeyLogReader {
+    const struct myKeyLogBlock *blocks; /*第一个数据块*/
+    void                *map;           /*映射地址*/
+    size_t              map_size;       /*映射大小*/
+    uint32_t            block_num;      /*数据块个数*/
+    uint32_t            block;          /*读位置所在的块*/
+    uint32_t            index;          /*读位置在块内的序号*/
+    uint64_t            time;           /*读位置前一条记录的时间*/
+};
+
+static int myKeyLog_write_block(struct myKeyLog *log, const struct myKeyLogBlock *b, off_t pos)
+{
+    if (pwrite(log->fd, b, sizeof(*b), pos) != (ssize_t)sizeof(*b)) {
+        debug_i("write log block failed,errno=%d", errno);
+        log->error = true;
+        return -1;
+    }
+    return 0;
+}
+
+static void MyKeyLog_Sink(MyKeyHandle KeyID, unsigned char KeyEvent, unsigned char KeyClickCount, void *Arg)
+{
+    struct myKeyLog *log = (struct myKeyLog *)Arg;
+    struct myKeyLogBlock *b = &log->block[log->cur];
+    uint64_t now = MyKey_GetTime() + log->offset;
+
+    /*块写满或者时间差超出32位时换另一个块，输出函数中不能阻塞，写满的块留给MyKeyLog_Flush写入文件*/
+    if ((b->num == MYKEYLOG_RECORD_NUM) || ((b->num != 0) && (now - log->last > UINT32_MAX))) {
+        if (log->full) {
+            log->dropped++;
+            return;
+        }
+        log->full = true;
+        log->full_pos = log->block_pos;
+        log->block_pos += MYKEYLOG_BLOCK_SIZE;
+        log->cur ^= 1;
+        b = &log->block[log->cur];
+        b->num = 0;
+    }
+    if (b->num == 0) {
+        b->base = now;
+        log->last = now;
+    }
+    struct myKeyLogRecord *rec = &b->records[b->num++];
+    rec->delta = (uint32_t)(now - log->last);
+    rec->key = (uint16_t)MyKey_GetIndex(KeyID);
+    rec->event = KeyEvent;
+    rec->count = KeyClickCount;
+    log->last = now;
+}
+
+static bool myKeyLog_check_header(const struct myKeyLogHeader *h)
+{
+    return (h->magic == MYKEYLOG_MAGIC) && (h->version == MYKEYLOG_VERSION) && (h->block_size == MYKEYLOG_BLOCK_SIZE)
+           && (h->record_size == sizeof(struct myKeyLogRecord)) && (h->ticks_per_ms == MYKEY_TICKS_PER_MS);
+}
+
+/*已经写入文件的最后一个块接着写，写满的块从下一个块开始*/
+static int myKeyLog_resume(struct myKeyLog *log, off_t size)
+{
+    struct myKeyLogHeader h;
+    uint32_t blocks = (uint32_t)((size - MYKEYLOG_BLOCK_SIZE) / MYKEYLOG_BLOCK_SIZE);
+
+    if ((pread(log->fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) || !myKeyLog_check_header(&h)) {
+        debug_i("invalid log header");
+        return -1;
+    }
+    log->block_pos = (off_t)MYKEYLOG_BLOCK_SIZE * (blocks + 1);
+    if (blocks == 0) {
+        return 0;
+    }
+    struct myKeyLogBlock *b = &log->block[0];
+    if ((pread(log->fd, b, sizeof(*b), log->block_pos - MYKEYLOG_BLOCK_SIZE) != (ssize_t)sizeof(*b))
+            || (b->num == 0) || (b->num > MYKEYLOG_RECORD_NUM)) {
+        debug_i("invalid last log block");
+        return -1;
+    }
+    uint64_t last = b->base;
+    for (uint32_t i = 0; i < b->num; i++) {
+        last += b->records[i].delta;
+    }
+    if (b->num < MYKEYLOG_RECORD_NUM) {
+        log->block_pos -= MYKEYLOG_BLOCK_SIZE;
+    } else {
+        b->num = 0;
+    }
+    log->last = last;
+    /*新记录的时间不早于文件中最后一条记录*/
+    if (last > MyKey_GetTime()) {
+        log->offset = last - MyKey_GetTime();
+    }
+    return 0;
+}
+
+myKeyLogHandle_t MyKeyLog_Create(const char *path)
+{
+    struct stat st;
+    if (NULL == path) {
+        return NULL;
+    }
+    struct myKeyLog *log = calloc(1, sizeof(struct myKeyLog));
+    if (NULL == log) {
+        return NULL;
+    }
+    log->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (log->fd < 0) {
+        debug_i("open %s failed,errno=%d", path, errno);
+        free(log);
+        return NULL;
+    }
+    if (fstat(log->fd, &st) != 0) {
+        close(log->fd);
+        free(log);
+        return NULL;
+    }
+    if (st.st_size < MYKEYLOG_BLOCK_SIZE) {
+        static const struct myKeyLogHeader h = {
+            MYKEYLOG_MAGIC, MYKEYLOG_VERSION, MYKEYLOG_BLOCK_SIZE, sizeof(struct myKeyLogRecord), MYKEY_TICKS_PER_MS, {0}
+        };
+        /*文件头占用一个块，数据块按块大小对齐*/
+        memcpy(&log->block[0], &h, sizeof(h));
+        if ((ftruncate(log->fd, 0) != 0) || (myKeyLog_write_block(log, &log->block[0], 0) != 0)) {
+            close(log->fd);
+            free(log);
+            return NULL;
+        }
+        memset(&log->block[0], 0, sizeof(log->block[0]));
+        log->block_pos = MYKEYLOG_BLOCK_SIZE;
+    } else if (myKeyLog_resume(log, st.st_size) != 0) {
+        close(log->fd);
+        free(log);
+        return NULL;
+    }
+
+    if (MyKey_AddSink(MyKeyLog_Sink, log) != 0) {
+        close(log->fd);
+        free(log);
+        return NULL;
+    }
+    return log;
+}
+
+int MyKeyLog_Flush(myKeyLogHandle_t log)
+{
+    if (NULL == log) {
+        return -1;
+    }
+    if (log->full) {
+        log->full = false;
+        myKeyLog_write_block(log, &log->block[log->cur ^ 1], log->full_pos);
+    }
+    if (log->block[log->cur].num != 0) {
+        myKeyLog_write_block(log, &log->block[log->cur], log->block_pos);
+    }
+    int rt = (log->error || (log->dropped != 0)) ? -1 : 0;
+    log->dropped = 0;
+    return rt;
+}
+
+void MyKeyLog_Delete(myKeyLogHandle_t log)
+{
+    if (NULL == log) {
+        return;
+    }
+    MyKey_RemoveSink(MyKeyLog_Sink, log);
+    MyKeyLog_Flush(log);
+    close(log->fd);
+    free(log);
+}
+
+myKeyLogReader_t MyKeyLog_Open(const char *path)
+{
+    struct stat st;
+    if (NULL == path) {
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        debug_i("open %s failed,errno=%d", path, errno);
+        return NULL;
+    }
+    if ((fstat(fd, &st) != 0) || (st.st_size < MYKEYLOG_BLOCK_SIZE)) {
+        close(fd);
+        return NULL;
+    }
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == addr) {
+        return NULL;
+    }
+    if (!myKeyLog_check_header((const struct myKeyLogHeader *)addr)) {
+        debug_i("%s invalid header", path);
+        munmap(addr, st.st_size);
+        return NULL;
+    }
+    struct myKeyLogReader *reader = calloc(1, sizeof(struct myKeyLogReader));
+    if (NULL == reader) {
+        munmap(addr, st.st_size);
+        return NULL;
+    }
+    reader->map = addr;
+    reader->map_size = st.st_size;
+    reader->blocks = (const struct myKeyLogBlock *)((const uint8_t *)addr + MYKEYLOG_BLOCK_SIZE);
+    reader->block_num = (uint32_t)((st.st_size - MYKEYLOG_BLOCK_SIZE) / MYKEYLOG_BLOCK_SIZE);
+    /*写到一半的块之后的数据都不读*/
+    for (uint32_t i = 0; i < reader->block_num; i++) {
+        if ((reader->blocks[i].num == 0) || (reader->blocks[i].num > MYKEYLOG_RECORD_NUM)) {
+            reader->block_num = i;
+            break;
+        }
+    }
+    MyKeyLog_Seek(reader, 0);
+    return reader;
+}
+
+void MyKeyLog_Close(myKeyLogReader_t reader)
+{
+    if (NULL == reader) {
+        return;
+    }
+    munmap(reader->map, reader->map_size);
+    free(reader);
+}
+
+/*读位置移动到块的第一条记录*/
+static void myKeyLog_enter(struct myKeyLogReader *reader, uint32_t block)
+{
+    reader->block = block;
+    reader->index = 0;
+    reader->time = (block < reader->block_num) ? reader->blocks[block].base : 0;
+}
+
+/*读取当前位置的记录时间，不移动读位置*/
+static int myKeyLog_peek(const struct myKeyLogReader *reader, uint64_t *time)
+{
+    if (reader->block >= reader->block_num) {
+        return -1;
+    }
+    *time = reader->time + reader->blocks[reader->block].records[reader->index].delta;
+    return 0;
+}
+
+static void myKeyLog_advance(struct myKeyLogReader *reader, uint64_t time)
+{
+    reader->time = time;
+    if (++reader->index == reader->blocks[reader->block].num) {
+        myKeyLog_enter(reader, reader->block + 1);
+    }
+}
+
+int MyKeyLog_Seek(myKeyLogReader_t reader, uint64_t Time)
+{
+    uint64_t time;
+    if (NULL == reader) {
+        return -1;
+    }
+    /*找最后一个起始时间小于Time的块，块的起始时间是递增的。
+     *时间等于Time的记录可能跨越块边界，从前一个块开始向后找才不会漏掉*/
+    uint32_t lo = 0, hi = reader->block_num;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (reader->blocks[mid].base < Time) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    myKeyLog_enter(reader, lo);
+    while (myKeyLog_peek(reader, &time) == 0) {
+        if (time >= Time) {
+            return 0;
+        }
+        myKeyLog_advance(reader, time);
+    }
+    return -1;
+}
+
+int MyKeyLog_Next(myKeyLogReader_t reader, myKeyLogRecord_t *rec)
+{
+    uint64_t time;
+    if ((NULL == reader) || (NULL == rec) || (myKeyLog_peek(reader, &time) != 0)) {
+        return -1;
+    }
+    const struct myKeyLogRecord *r = &reader->blocks[reader->block].records[reader->index];
+    rec->Time = time;
+    rec->KeyIndex = r->key;
+    rec->KeyEvent = r->event;
+    rec->KeyClickCount = r->count;
+    myKeyLog_advance(reader, time);
+    return 0;
+}
@@ -0,0 +1,108 @@
+/**
+  * @file       MyKeyLog.h
+  * @author     mgdg
+  * @brief      按键事件二进制日志
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     把MyKey_Scan产生的每个按键事件以定长记录追加到文件中，用于长时间记录按键输入。
+  *             文件由固定大小的块组成，块头保存第一条记录的绝对时间，块内记录只保存与前一条记录的时间差。
+  *             写入先缓存在内存中，使用两个块交替缓存，扫描中不写文件，调用MyKeyLog_Flush时才写文件。
+  *             读取时把文件映射到内存，可以顺序遍历，也可以按时间二分查找。
+  *             仅支持Linux。
+  */
+
+#ifndef __MYKEYLOG_H
+#define __MYKEYLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*日志写入句柄*/
+typedef struct myKeyLog *myKeyLogHandle_t;
+
+/*日志读取句柄*/
+typedef struct myKeyLogReader *myKeyLogReader_t;
+
+/*日志中的一条按键事件*/
+typedef struct {
+    uint64_t            Time;           /*扫描累计时间，单位为计时单位（见MYKEY_TICKS_PER_MS）*/
+    uint16_t            KeyIndex;       /*按键序号，见MyKey_GetIndex*/
+    uint8_t             KeyEvent;       /*按键事件*/
+    uint8_t             KeyClickCount;  /*按键次数计数*/
+} myKeyLogRecord_t;
+
+/**
+  * @brief  打开日志文件并开始记录按键事件，需要在MyKey_Init之后、不在扫描时调用
+  * @param  *path：日志文件路径，文件不存在时创建，已存在时接着追加
+  *
+  * @return myKeyLogHandle_t：日志句柄，失败返回NULL
+  * @remark 追加时新记录的时间接在文件中最后一条记录之后，整个文件的时间保持递增
+  */
+myKeyLogHandle_t MyKeyLog_Create(const char *path);
+
+/**
+  * @brief  把缓存的记录写入文件
+  * @param  log：日志句柄
+  *
+  * @return int：0:success, other:写文件失败或者上次调用之后有记录被丢弃
+  * @remark 需要与MyKey_Scan在同一个线程中周期调用，如每秒一次。
+  *         一个块写满之后另一个块也写满之前需要调用，否则新的记录被丢弃
+  */
+int MyKeyLog_Flush(myKeyLogHandle_t log);
+
+/**
+  * @brief  停止记录，写入缓存的记录并关闭日志文件，文件保留
+  * @param  log：日志句柄
+  *
+  * @return void
+  * @remark
+  */
+void MyKeyLog_Delete(myKeyLogHandle_t log);
+
+/**
+  * @brief  以只读方式映射日志文件，读位置在第一条记录
+  * @param  *path：日志文件路径
+  *
+  * @return myKeyLogReader_t：读取句柄，失败返回NULL
+  * @remark 只能读到打开时已经写入文件的记录
+  */
+myKeyLogReader_t MyKeyLog_Open(const char *path);
+
+/**
+  * @brief  关闭日志文件
+  * @param  reader：读取句柄
+  *
+  * @return void
+  * @remark
+  */
+void MyKeyLog_Close(myKeyLogReader_t reader);
+
+/**
+  * @brief  二分查找，把读位置移动到第一条时间不小于Time的记录
+  * @param  reader：读取句柄
+  * @param  Time：时间，0表示第一条记录
+  *
+  * @return int：0:success, other:没有这样的记录，读位置移动到文件末尾
+  * @remark
+  */
+int MyKeyLog_Seek(myKeyLogReader_t reader, uint64_t Time);
+
+/**
+  * @brief  读取当前位置的记录，读位置后移一条
+  * @param  reader：读取句柄
+  * @param  *rec：记录
+  *
+  * @return int：0:success, other:已经读到文件末尾
+  * @remark
+  */
+int MyKeyLog_Next(myKeyLogReader_t reader, myKeyLogRecord_t *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,238 @@
+/**
+  * @file       MyKeyShm.c
+  * @author     mgdg
+  * @brief      按键事件共享内存总线
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     把MyKey_Scan产生的按键事件发布到POSIX共享内存环形队列中，队列布局与myQueue一致，
+  *             本机的多个进程可以只读映射并读取按键事件，不需要socket和中转进程。
+  *             一个共享内存只能有一个发布者，读者数量不限，每个读者有自己的读指针。
+  *             仅支持Linux。
+  */
+
+#include "MyKeyShm.h"
+#include "MyKeyDrive.h"
+#include "MyQueue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define debug_i(format,...)             /*printf(format"\n",##__VA_ARGS__)*/
+#define MYKEYSHM_MAGIC                  (0x4D4B5348U)       /*"MKSH"*/
+#define MYKEYSHM_VERSION                (1U)
+
+/*共享内存头，后面紧跟数据缓冲区。与myQueue相同的len/size/front/rear布局，
+ *但front是每个读者私有的，共享内存中只保存写入位置*/
+struct myKeyShmHeader {
+    uint32_t            magic;          /*初始化完成后写入*/
+    uint32_t            version;
+    uint32_t            len;            /*队列长度，2的幂*/
+    uint32_t            size;           /*单个数据大小(单位 字节)*/
+    uint32_t            rear;           /*已写入消息总数，同时作为futex等待字*/
+    uint32_t            reserved[3];
+};
+
+struct myKeyShm {
+    struct myKeyShmHeader *header;      /*共享内存映射地址*/
+    myKeyShmMsg_t       *buffer;        /*数据缓冲区*/
+    size_t              map_size;       /*映射大小*/
+    uint32_t            front;          /*读者私有的读位置*/
+    bool                owner;          /*是否是发布者*/
+    char                name[NAME_MAX];
+};
+
+static long myKeyShm_futex(uint32_t *addr, int op, uint32_t val, const struct timespec *timeout)
+{
+    return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+}
+
+static void MyKeyShm_Sink(MyKeyHandle KeyID, unsigned char KeyEvent, unsigned char KeyClickCount, void *Arg)
+{
+    struct myKeyShm *bus = (struct myKeyShm *)Arg;
+    myKeyShmMsg_t msg = {0};
+
+    msg.KeyID = (uint64_t)(uintptr_t)KeyID;
+    msg.KeyEvent = KeyEvent;
+    msg.KeyClickCount = KeyClickCount;
+    myQueueLappedPut(bus->buffer, bus->header->len, sizeof(myKeyShmMsg_t), &bus->header->rear, &msg);
+}
+
+//一次扫描的所有消息写完之后才唤醒读者，每次扫描最多一次系统调用
+static void MyKeyShm_Wake(void *Arg)
+{
+    struct myKeyShm *bus = (struct myKeyShm *)Arg;
+    myKeyShm_futex(&bus->header->rear, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+myKeyShmHandle_t MyKeyShm_Create(const char *name, size_t queue_len)
+{
+    if ((NULL == name) || (queue_len < 2) || (queue_len & (queue_len - 1)) || (strlen(name) >= NAME_MAX)) {
+        debug_i("create shm,name=%s,len=%d", name, queue_len);
+        return NULL;
+    }
+    struct myKeyShm *bus = calloc(1, sizeof(struct myKeyShm));
+    if (NULL == bus) {
+        return NULL;
+    }
+    bus->map_size = sizeof(struct myKeyShmHeader) + queue_len * sizeof(myKeyShmMsg_t);
+    /*不能截断或者复用已经存在的共享内存，它可能还在被另一个发布者写入*/
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, MYKEYSHM_MODE);
+    if (fd < 0) {
+        debug_i("shm_open %s failed,errno=%d", name, errno);
+        free(bus);
+        return NULL;
+    }
+    if (ftruncate(fd, bus->map_size) != 0) {
+        close(fd);
+        shm_unlink(name);
+        free(bus);
+        return NULL;
+    }
+    void *addr = mmap(NULL, bus->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == addr) {
+        shm_unlink(name);
+        free(bus);
+        return NULL;
+    }
+    bus->header = (struct myKeyShmHeader *)addr;
+    bus->buffer = (myKeyShmMsg_t *)(bus->header + 1);
+    bus->owner = true;
+    strcpy(bus->name, name);
+    bus->header->version = MYKEYSHM_VERSION;
+    bus->header->len = (uint32_t)queue_len;
+    bus->header->size = sizeof(myKeyShmMsg_t);
+    bus->header->rear = 0;
+    __atomic_store_n(&bus->header->magic, MYKEYSHM_MAGIC, __ATOMIC_RELEASE);
+
+    if ((MyKey_AddSink(MyKeyShm_Sink, bus) != 0) || (MyKey_SetSinkFlush(MyKeyShm_Sink, bus, MyKeyShm_Wake) != 0)) {
+        MyKey_RemoveSink(MyKeyShm_Sink, bus);
+        munmap(addr, bus->map_size);
+        shm_unlink(name);
+        free(bus);
+        return NULL;
+    }
+    return bus;
+}
+
+void MyKeyShm_Delete(myKeyShmHandle_t bus)
+{
+    if ((NULL == bus) || !bus->owner) {
+        return;
+    }
+    MyKey_RemoveSink(MyKeyShm_Sink, bus);
+    munmap(bus->header, bus->map_size);
+    shm_unlink(bus->name);
+    free(bus);
+}
+
+myKeyShmHandle_t MyKeyShm_Open(const char *name)
+{
+    struct stat st;
+    if (NULL == name) {
+        return NULL;
+    }
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        debug_i("shm_open %s failed,errno=%d", name, errno);
+        return NULL;
+    }
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(struct myKeyShmHeader))) {
+        close(fd);
+        return NULL;
+    }
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == addr) {
+        return NULL;
+    }
+    struct myKeyShmHeader *h = (struct myKeyShmHeader *)addr;
+    if ((__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != MYKEYSHM_MAGIC) || (h->version != MYKEYSHM_VERSION)
+            || (h->size != sizeof(myKeyShmMsg_t)) || (h->len == 0) || (h->len & (h->len - 1))
+            || ((size_t)st.st_size < sizeof(struct myKeyShmHeader) + (size_t)h->len * h->size)) {
+        debug_i("shm %s invalid header", name);
+        munmap(addr, st.st_size);
+        return NULL;
+    }
+    struct myKeyShm *bus = calloc(1, sizeof(struct myKeyShm));
+    if (NULL == bus) {
+        munmap(addr, st.st_size);
+        return NULL;
+    }
+    bus->header = h;
+    bus->buffer = (myKeyShmMsg_t *)(h + 1);
+    bus->map_size = st.st_size;
+    bus->front = __atomic_load_n(&h->rear, __ATOMIC_ACQUIRE);
+    bus->owner = false;
+    return bus;
+}
+
+void MyKeyShm_Close(myKeyShmHandle_t bus)
+{
+    if ((NULL == bus) || bus->owner) {
+        return;
+    }
+    munmap(bus->header, bus->map_size);
+    free(bus);
+}
+
+int MyKeyShm_Read(myKeyShmHandle_t bus, myKeyShmMsg_t *msg)
+{
+    if ((NULL == bus) || (NULL == msg)) {
+        return -1;
+    }
+    return myQueueLappedGet(bus->buffer, bus->header->len, sizeof(myKeyShmMsg_t), &bus->header->rear, &bus->front, msg) ? 0 : -1;
+}
+
+int MyKeyShm_Wait(myKeyShmHandle_t bus, int timeout_ms)
+{
+    struct timespec deadline, now, ts;
+    if (NULL == bus) {
+        return -1;
+    }
+    //被信号打断后只等待剩余的时间
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (1) {
+        uint32_t rear = __atomic_load_n(&bus->header->rear, __ATOMIC_ACQUIRE);
+        if (rear != bus->front) {
+            return 0;
+        }
+        if (timeout_ms >= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            ts.tv_sec = deadline.tv_sec - now.tv_sec;
+            ts.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+            if (ts.tv_nsec < 0) {
+                ts.tv_sec--;
+                ts.tv_nsec += 1000000000L;
+            }
+            if (ts.tv_sec < 0) {
+                return -1;
+            }
+        }
+        //futex只读取等待字，只读映射也可以等待；相对超时按CLOCK_MONOTONIC计时
+        if (myKeyShm_futex(&bus->header->rear, FUTEX_WAIT, rear, (timeout_ms < 0) ? NULL : &ts) != 0) {
+            if (errno == ETIMEDOUT) {
+                return -1;
+            }
+            if ((errno != EAGAIN) && (errno != EINTR)) {
+                return -1;
+            }
+        }
+    }
+}
@@ -0,0 +1,102 @@
+/**
+  * @file       MyKeyShm.h
+  * @author     mgdg
+  * @brief      按键事件共享内存总线
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     把MyKey_Scan产生的按键事件发布到POSIX共享内存环形队列中，队列布局与myQueue一致，
+  *             本机的多个进程可以只读映射并读取按键事件，不需要socket和中转进程。
+  *             一个共享内存只能有一个发布者，读者数量不限，每个读者有自己的读指针。
+  *             仅支持Linux。
+  */
+
+#ifndef __MYKEYSHM_H
+#define __MYKEYSHM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*创建共享内存的权限，读者与发布者不是同一个用户时需要改为0644等*/
+#ifndef MYKEYSHM_MODE
+#define MYKEYSHM_MODE                   (0600)
+#endif
+
+/*共享内存总线句柄*/
+typedef struct myKeyShm *myKeyShmHandle_t;
+
+/*共享内存中的按键消息*/
+typedef struct {
+    uint64_t            KeyID;          /*发布进程中的按键句柄值，按键注册期间不变*/
+    uint8_t             KeyEvent;       /*按键事件*/
+    uint8_t             KeyClickCount;  /*按键次数计数*/
+    uint8_t             reserved[6];
+} myKeyShmMsg_t;
+
+/**
+  * @brief  创建共享内存总线并开始发布按键事件，需要在MyKey_Init之后调用
+  * @param  *name：共享内存名字，如"/mykey"
+  * @param  queue_len：队列长度，必须是2的幂
+  *
+  * @return myKeyShmHandle_t：总线句柄，失败返回NULL
+  * @remark 一次扫描的所有消息写入之后唤醒一次等待的读者。
+  *         共享内存以MYKEYSHM_MODE权限新建，名字已经存在时失败（errno为EEXIST），不会截断其它发布者的共享内存；
+  *         发布者异常退出留下的共享内存需要先用shm_unlink删除
+  */
+myKeyShmHandle_t MyKeyShm_Create(const char *name, size_t queue_len);
+
+/**
+  * @brief  停止发布并删除共享内存总线
+  * @param  bus：总线句柄
+  *
+  * @return void
+  * @remark
+  */
+void MyKeyShm_Delete(myKeyShmHandle_t bus);
+
+/**
+  * @brief  以只读方式打开共享内存总线
+  * @param  *name：共享内存名字
+  *
+  * @return myKeyShmHandle_t：总线句柄，失败返回NULL
+  * @remark 打开之后只能读到之后发布的消息
+  */
+myKeyShmHandle_t MyKeyShm_Open(const char *name);
+
+/**
+  * @brief  关闭共享内存总线
+  * @param  bus：总线句柄
+  *
+  * @return void
+  * @remark
+  */
+void MyKeyShm_Close(myKeyShmHandle_t bus);
+
+/**
+  * @brief  读取一个按键消息
+  * @param  bus：总线句柄
+  * @param  *msg：消息
+  *
+  * @return int：0:success, other:没有消息
+  * @remark 读取太慢时最旧的消息会被覆盖，被覆盖的消息会被跳过
+  */
+int MyKeyShm_Read(myKeyShmHandle_t bus, myKeyShmMsg_t *msg);
+
+/**
+  * @brief  等待新的按键消息
+  * @param  bus：总线句柄
+  * @param  timeout_ms：超时时间，单位ms，小于0表示一直等待
+  *
+  * @return int：0:有消息可读, other:超时或者出错
+  * @remark 使用futex等待，不需要写共享内存
+  */
+int MyKeyShm_Wait(myKeyShmHandle_t bus, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
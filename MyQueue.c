@@ -5,6 +5,7 @@
   * @version    v1.1
   * @date       2019-09-12
   * @remark     创建可以存放任意元素的环形队列，包含了入队出队等基本操作
+  *             也可以创建变长记录队列，每条记录带长度，可以直接在队列缓冲区中写入和读取
   */
 
 /*只有一个生产者和消费者的情况下不需要锁保护*/
@@ -13,6 +14,7 @@
 #include "MyQueue.h"
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include <assert.h>
 
 #ifdef MYQUEUE_USE_LOCK
@@ -32,6 +34,9 @@
 
 #define debug_i(format,...)             /*printf(format"\n",##__VA_ARGS__)*/
 #define NUM_IN_QUEUE(v)                 ((((v)->front) <= ((v)->rear))?(((v)->rear)-((v)->front)):(((v)->len)-((v)->front)+((v)->rear)))
+#define RECORD_HEAD_SIZE                (sizeof(uint32_t))                  /*变长记录的长度字段大小，也是记录的对齐大小*/
+#define RECORD_WRAP                     (0xFFFFFFFFUL)                      /*长度字段为该值表示后面的空间未使用，下一条记录在缓冲区开头*/
+#define RECORD_SPACE(n)                 (RECORD_HEAD_SIZE + (((n) + RECORD_HEAD_SIZE - 1) & ~(RECORD_HEAD_SIZE - 1)))
 #define LFET_NUM_IN_QUEUE(v)            ((((v)->front) <= ((v)->rear))?((((v)->len)-1)-(((v)->rear)-((v)->front))):(((v)->front)-((v)->rear)-1))
 
 struct myQueue {
@@ -40,6 +45,8 @@ struct myQueue {
     size_t              size;           /*单个数据大小(单位 字节)*/
     size_t              front;          /*数据头,指向下一个空闲存放地址*/
     size_t              rear;           /*数据尾，指向第一个数据*/
+    size_t              reserve;        /*变长记录队列预留空间的位置*/
+    size_t              reserve_len;    /*变长记录队列预留空间的大小，0表示没有预留*/
 #ifdef MYQUEUE_USE_LOCK
     SemaphoreHandle_t   lock;           /*保护锁*/
 #endif
@@ -127,7 +134,7 @@ static void *myQueue_memcpy(void *dst, const void *src, size_t n)
 
 bool myQueuePut(myQueueHandle_t queue, const void *buf, size_t num)
 {
-    if ((NULL == queue) || (NULL == queue->buffer) || (NULL == buf) || (0 == num)) {
+    if ((NULL == queue) || (NULL == queue->buffer) || (0 == queue->size) || (NULL == buf) || (0 == num)) {
         debug_i("put queue=%p,buf=%p,num=%d", queue, buf, num);
         return false;
     }
@@ -157,7 +164,7 @@ bool myQueuePut(myQueueHandle_t queue, const void *buf, size_t num)
 
 bool myQueueGet(myQueueHandle_t queue, void *buf, size_t num)
 {
-    if ((NULL == queue) || (NULL == queue->buffer) || (NULL == buf) || (0 == num)) {
+    if ((NULL == queue) || (NULL == queue->buffer) || (0 == queue->size) || (NULL == buf) || (0 == num)) {
         debug_i("get queue=%p,buf=%p,num=%d", queue, buf, num);
         return false;
     }
@@ -187,7 +194,7 @@ bool myQueueGet(myQueueHandle_t queue, void *buf, size_t num)
 
 bool myQueuePeek(const myQueueHandle_t queue, void *buf, size_t num, size_t offset)
 {
-    if ((NULL == queue) || (NULL == queue->buffer) || (NULL == buf) || (0 == num)) {
+    if ((NULL == queue) || (NULL == queue->buffer) || (0 == queue->size) || (NULL == buf) || (0 == num)) {
         debug_i("peek queue=%p,buf=%p,num=%d", queue, buf, num);
         return false;
     }
@@ -213,7 +220,7 @@ bool myQueuePeek(const myQueueHandle_t queue, void *buf, size_t num, size_t offs
 
 bool myQueuePop(myQueueHandle_t queue, size_t num)
 {
-    if ((NULL == queue) || (0 == num)) {
+    if ((NULL == queue) || (0 == queue->size) || (0 == num)) {
         debug_i("pop queue=%p,num=%d", queue, num);
         return false;
     }
@@ -241,3 +248,134 @@ bool myQueuePopAll(myQueueHandle_t queue)
     return true;
 }
 
+myQueueHandle_t myQueueCreateRecord(size_t buf_size)
+{
+    buf_size &= ~(RECORD_HEAD_SIZE - 1);
+    if (buf_size < 2 * RECORD_HEAD_SIZE) {
+        debug_i("create record queue,size=%d", buf_size);
+        return NULL;
+    }
+    myQueueHandle_t queue = calloc(1, sizeof(struct myQueue));
+    assert(queue);
+    queue->size = 0;
+    queue->len = buf_size;
+    queue->buffer = malloc(queue->len);
+    assert(queue->buffer);
+    queue->front = queue->rear = 0;
+    MYQUEUE_API_CREATELOCK(queue);
+    MYQUEUE_API_UNLOCK(queue);
+    return queue;
+}
+
+void *myQueueReserve(myQueueHandle_t queue, size_t len)
+{
+    /*先按缓冲区长度检查len，避免RECORD_SPACE在32位size_t上溢出*/
+    if ((NULL == queue) || (NULL == queue->buffer) || (0 != queue->size) || (len >= RECORD_WRAP) ||
+        (len > queue->len - RECORD_HEAD_SIZE)) {
+        debug_i("reserve queue=%p,len=%d", queue, len);
+        return NULL;
+    }
+    void *rt = NULL;
+    size_t space = RECORD_SPACE(len);
+    MYQUEUE_API_LOCK(queue);
+    /*写满之后rear不能追上front，否则与队列空无法区分*/
+    if (queue->front <= queue->rear) {
+        if ((queue->rear + space < queue->len) || ((queue->rear + space == queue->len) && (queue->front != 0))) {
+            queue->reserve = queue->rear;
+        } else if (space < queue->front) {
+            queue->reserve = 0;
+        } else {
+            space = 0;
+        }
+    } else if (queue->rear + space < queue->front) {
+        queue->reserve = queue->rear;
+    } else {
+        space = 0;
+    }
+    if (space) {
+        queue->reserve_len = space;
+        rt = (char *)(queue->buffer) + queue->reserve + RECORD_HEAD_SIZE;
+    } else {
+        debug_i("reserve failed, len=%d,front=%d,rear=%d,len=%d", len, queue->front, queue->rear, queue->len);
+    }
+    MYQUEUE_API_UNLOCK(queue);
+    return rt;
+}
+
+bool myQueueCommit(myQueueHandle_t queue, size_t len)
+{
+    if ((NULL == queue) || (0 != queue->size) || (0 == queue->reserve_len) || (RECORD_SPACE(len) > queue->reserve_len)) {
+        debug_i("commit queue=%p,len=%d", queue, len);
+        return false;
+    }
+    MYQUEUE_API_LOCK(queue);
+    *(uint32_t *)((char *)(queue->buffer) + queue->reserve) = (uint32_t)len;
+    /*从缓冲区开头预留时，标记原来的队尾到缓冲区末尾之间的空间未使用*/
+    if (queue->reserve != queue->rear) {
+        *(uint32_t *)((char *)(queue->buffer) + queue->rear) = RECORD_WRAP;
+    }
+    queue->rear = (queue->reserve + RECORD_SPACE(len)) % (queue->len);
+    queue->reserve_len = 0;
+    MYQUEUE_API_UNLOCK(queue);
+    return true;
+}
+
+bool myQueuePutRecord(myQueueHandle_t queue, const void *buf, size_t len)
+{
+    if ((NULL == buf) && (0 != len)) {
+        return false;
+    }
+    void *p = myQueueReserve(queue, len);
+    if (NULL == p) {
+        return false;
+    }
+    if (len > 0) {
+        myQueue_memcpy(p, buf, len);
+    }
+    return myQueueCommit(queue, len);
+}
+
+const void *myQueuePeekRecord(myQueueHandle_t queue, size_t *len)
+{
+    if ((NULL == queue) || (NULL == queue->buffer) || (0 != queue->size) || (NULL == len)) {
+        debug_i("peek record queue=%p,len=%p", queue, len);
+        return NULL;
+    }
+    const void *rt = NULL;
+    MYQUEUE_API_LOCK(queue);
+    if (queue->front != queue->rear) {
+        uint32_t head = *(const uint32_t *)((const char *)(queue->buffer) + queue->front);
+        if (RECORD_WRAP == head) {
+            queue->front = 0;
+            head = *(const uint32_t *)(queue->buffer);
+        }
+        *len = head;
+        rt = (const char *)(queue->buffer) + queue->front + RECORD_HEAD_SIZE;
+    }
+    MYQUEUE_API_UNLOCK(queue);
+    return rt;
+}
+
+bool myQueuePopRecord(myQueueHandle_t queue)
+{
+    size_t len;
+    if (NULL == myQueuePeekRecord(queue, &len)) {
+        return false;
+    }
+    MYQUEUE_API_LOCK(queue);
+    queue->front = (queue->front + RECORD_SPACE(len)) % (queue->len);
+    MYQUEUE_API_UNLOCK(queue);
+    return true;
+}
+
+bool myQueueGetRecord(myQueueHandle_t queue, void *buf, size_t buf_size, size_t *len)
+{
+    const void *p = myQueuePeekRecord(queue, len);
+    if ((NULL == p) || ((*len > 0) && ((NULL == buf) || (*len > buf_size)))) {
+        return false;
+    }
+    if (*len > 0) {
+        myQueue_memcpy(buf, p, *len);
+    }
+    return myQueuePopRecord(queue);
+}
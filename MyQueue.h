@@ -5,6 +5,7 @@
   * @version    v1.1
   * @date       2019-09-12
   * @remark     创建可以存放任意元素的环形队列，包含了入队出队等基本操作
+  *             也可以创建变长记录队列，每条记录带长度，可以直接在队列缓冲区中写入和读取
   */
 
 #ifndef __MYQUEUE_H
@@ -12,6 +13,8 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 /*队列句柄*/
 typedef struct myQueue *myQueueHandle_t;
@@ -133,4 +136,179 @@ bool myQueuePop(myQueueHandle_t queue, size_t num);
   */
 bool myQueuePopAll(myQueueHandle_t queue);
 
+/**
+  * @brief  创建变长记录队列，缓冲区按字节使用，每条记录占用4字节长度加上4字节对齐的数据
+  * @param  buf_size：缓冲区大小，以字节为单位，按4字节向下对齐，不能小于8
+
+  * @return myQueueHandle_t：队列句柄
+  * @remark 只能使用myQueueXxxRecord、myQueueReserve、myQueueCommit、myQueuePopAll和数据个数相关的接口，
+  *         数据个数相关的接口以字节为单位，包括长度和对齐占用的空间；
+  *         记录必须连续存放，单条记录占用的空间小于缓冲区的一半时才能保证队列空时一定可以放入
+  */
+myQueueHandle_t myQueueCreateRecord(size_t buf_size);
+
+/**
+  * @brief  在变长记录队列中预留一段连续空间，写好数据之后调用myQueueCommit放入队列
+  * @param  queue：队列句柄
+  * @param  len：记录长度，以字节为单位
+  *
+  * @return void *：预留空间的地址，4字节对齐，空间不足返回NULL
+  * @remark 队列尾部的连续空间不够时从缓冲区开头预留；只能有一个生产者，提交之前不能再次预留
+  */
+void *myQueueReserve(myQueueHandle_t queue, size_t len);
+
+/**
+  * @brief  把预留空间中的数据作为一条记录放入队列
+  * @param  queue：队列句柄
+  * @param  len：实际记录长度，不能超过预留的长度
+  *
+  * @return bool：是否放入成功
+  * @remark
+  */
+bool myQueueCommit(myQueueHandle_t queue, size_t len);
+
+/**
+  * @brief  将一条记录放入变长记录队列
+  * @param  queue：队列句柄
+  * @param  *buf：数据指针
+  * @param  len：记录长度，以字节为单位
+  *
+  * @return bool：是否放入成功
+  * @remark
+  */
+bool myQueuePutRecord(myQueueHandle_t queue, const void *buf, size_t len);
+
+/**
+  * @brief  获取变长记录队列中最早的一条记录，不拷贝也不弹出
+  * @param  queue：队列句柄
+  * @param  *len：记录长度
+  *
+  * @return const void *：记录在队列缓冲区中的地址，4字节对齐，队列空返回NULL
+  * @remark 地址在调用myQueuePopRecord之前一直有效；只能有一个消费者
+  */
+const void *myQueuePeekRecord(myQueueHandle_t queue, size_t *len);
+
+/**
+  * @brief  弹掉变长记录队列中最早的一条记录
+  * @param  queue：队列句柄
+  *
+  * @return bool：是否弹出成功
+  * @remark
+  */
+bool myQueuePopRecord(myQueueHandle_t queue);
+
+/**
+  * @brief  从变长记录队列中取出一条记录
+  * @param  queue：队列句柄
+  * @param  *buf：数据指针
+  * @param  buf_size：数据缓冲区大小
+  * @param  *len：记录长度
+  *
+  * @return bool：是否取出成功，缓冲区太小时不取出
+  * @remark
+  */
+bool myQueueGetRecord(myQueueHandle_t queue, void *buf, size_t buf_size, size_t *len);
+
+/**
+  * @brief  定义元素类型和长度在编译时确定的静态队列
+  * @param  name：队列类型名，同时作为生成的接口前缀
+  * @param  type：元素类型
+  * @param  len：队列长度，必须是2的幂
+  *
+  * @return 生成队列类型name_t和以下内联接口：
+  *         void nameInit(name_t *queue)                        清空队列
+  *         size_t nameNum(const name_t *queue)                 队列已存放数据个数
+  *         bool namePut(name_t *queue, const type *item)       放入一个数据
+  *         bool nameGet(name_t *queue, type *item)             取出一个数据
+  * @remark 与myQueue相比不需要动态分配，下标用掩码计算，数据用结构体赋值拷贝，可以存满len个数据；
+  *         只有一个生产者和一个消费者时不需要锁保护
+  */
+#define MYQUEUE_STATIC_DEFINE(name, type, len)                                          \
+typedef struct {                                                                        \
+    type                buffer[len];    /*数据缓冲区*/                                  \
+    size_t              front;          /*已取出数据总数*/                              \
+    size_t              rear;           /*已放入数据总数*/                              \
+} name##_t;                                                                             \
+typedef char name##_LenCheck[(((len) > 0) && (((len) & ((len) - 1)) == 0)) ? 1 : -1];  \
+static inline void name##Init(name##_t *queue)                                          \
+{                                                                                       \
+    queue->front = queue->rear = 0;                                                     \
+}                                                                                       \
+static inline size_t name##Num(const name##_t *queue)                                   \
+{                                                                                       \
+    return __atomic_load_n(&queue->rear, __ATOMIC_ACQUIRE) - __atomic_load_n(&queue->front, __ATOMIC_ACQUIRE); \
+}                                                                                       \
+static inline bool name##Put(name##_t *queue, const type *item)                         \
+{                                                                                       \
+    size_t rear = queue->rear;                                                          \
+    if (rear - __atomic_load_n(&queue->front, __ATOMIC_ACQUIRE) >= (len)) {             \
+        return false;                                                                   \
+    }                                                                                   \
+    queue->buffer[rear & ((len) - 1)] = *item;                                          \
+    __atomic_store_n(&queue->rear, rear + 1, __ATOMIC_RELEASE);                         \
+    return true;                                                                        \
+}                                                                                       \
+static inline bool name##Get(name##_t *queue, type *item)                               \
+{                                                                                       \
+    size_t front = queue->front;                                                        \
+    if (front == __atomic_load_n(&queue->rear, __ATOMIC_ACQUIRE)) {                     \
+        return false;                                                                   \
+    }                                                                                   \
+    *item = queue->buffer[front & ((len) - 1)];                                         \
+    __atomic_store_n(&queue->front, front + 1, __ATOMIC_RELEASE);                       \
+    return true;                                                                        \
+}
+
+/**
+  * @brief  向覆盖式环形缓冲区写入一个数据，缓冲区满时直接覆盖最旧的数据，不等待读者
+  * @param  *ring：缓冲区，len个size字节的数据
+  * @param  len：缓冲区长度，必须是2的幂
+  * @param  size：单个数据大小(单位 字节)
+  * @param  *seq：已写入数据总数，只能有一个写者
+  * @param  *item：写入的数据
+  *
+  * @return void
+  * @remark 读者用myQueueLappedGet读取，读者个数不限，每个读者有自己的读位置，读写都不需要锁
+  */
+static inline void myQueueLappedPut(void *ring, uint32_t len, size_t size, uint32_t *seq, const void *item)
+{
+    uint32_t rear = *seq;
+    /*改写的位置是最旧的数据，读者看到改写的数据时一定也能看到之前发布的总数，从而发现被覆盖*/
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((char *)ring + (rear & (len - 1)) * size, item, size);
+    /*先写数据再发布总数，读者看到新总数时数据一定已经写好*/
+    __atomic_store_n(seq, rear + 1, __ATOMIC_RELEASE);
+}
+
+/**
+  * @brief  从覆盖式环形缓冲区读取一个数据
+  * @param  *ring、len、size、*seq：与myQueueLappedPut相同
+  * @param  *pos：读者私有的读位置，读到数据后加1，落后太多时先跳到最旧的可读数据
+  * @param  *item：读出的数据
+  *
+  * @return bool：是否读到数据，没有新数据时返回false
+  * @remark 写者可能正在改写最旧的位置，所以最多只能读到len-1个；被覆盖的数据被跳过
+  */
+static inline bool myQueueLappedGet(const void *ring, uint32_t len, size_t size, const uint32_t *seq, uint32_t *pos, void *item)
+{
+    while (1) {
+        uint32_t rear = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        if (*pos == rear) {
+            return false;
+        }
+        if ((uint32_t)(rear - *pos) >= len) {
+            *pos = rear - (len - 1);
+        }
+        memcpy(item, (const char *)ring + (*pos & (len - 1)) * size, size);
+        /*拷贝期间被覆盖则重新读取*/
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        rear = __atomic_load_n(seq, __ATOMIC_RELAXED);
+        if ((uint32_t)(rear - *pos) >= len) {
+            continue;
+        }
+        (*pos)++;
+        return true;
+    }
+}
+
 #endif
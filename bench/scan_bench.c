@@ -0,0 +1,175 @@
+/**
+  * @file       scan_bench.c
+  * @author     mgdg
+  * @brief      MyKey_Scan的扫描耗时和缓存缺失
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     注册32个按键，分别测量全部松开、全部按住和随机按键三种负载下每个按键每次扫描的耗时，
+  *             Linux下用perf_event_open统计缓存缺失，没有权限或者不支持时只输出耗时。
+  *             只使用MyKey_Init、MyKey_Deinit、MyKey_Register、MyKey_Scan和MyKey_Read，可以与旧版本一起编译对比。
+  *             编译运行（在仓库根目录）：
+  *             gcc -O2 -I. bench/scan_bench.c MyKeyDrive.c MyQueue.c -o scan_bench && ./scan_bench
+  */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "MyKeyDrive.h"
+
+#define BENCH_KEYS                      (32)
+#define BENCH_SCANS                     (2000000)
+#define BENCH_REPEAT                    (3)
+
+static int Raw[BENCH_KEYS];
+static uint32_t Seed = 12345;
+
+#define KEY_FUNC(n)                     static int Key##n(void) { return Raw[n]; }
+KEY_FUNC(0)  KEY_FUNC(1)  KEY_FUNC(2)  KEY_FUNC(3)  KEY_FUNC(4)  KEY_FUNC(5)  KEY_FUNC(6)  KEY_FUNC(7)
+KEY_FUNC(8)  KEY_FUNC(9)  KEY_FUNC(10) KEY_FUNC(11) KEY_FUNC(12) KEY_FUNC(13) KEY_FUNC(14) KEY_FUNC(15)
+KEY_FUNC(16) KEY_FUNC(17) KEY_FUNC(18) KEY_FUNC(19) KEY_FUNC(20) KEY_FUNC(21) KEY_FUNC(22) KEY_FUNC(23)
+KEY_FUNC(24) KEY_FUNC(25) KEY_FUNC(26) KEY_FUNC(27) KEY_FUNC(28) KEY_FUNC(29) KEY_FUNC(30) KEY_FUNC(31)
+static const KeyStatusFunc KeyFuncs[BENCH_KEYS] = {
+    Key0,  Key1,  Key2,  Key3,  Key4,  Key5,  Key6,  Key7,
+    Key8,  Key9,  Key10, Key11, Key12, Key13, Key14, Key15,
+    Key16, Key17, Key18, Key19, Key20, Key21, Key22, Key23,
+    Key24, Key25, Key26, Key27, Key28, Key29, Key30, Key31,
+};
+
+typedef enum {
+    BENCH_IDLE = 0,                             /** 全部松开 */
+    BENCH_HELD,                                 /** 全部按住，计时器一直在计时 */
+    BENCH_MIXED,                                /** 随机按下松开，带抖动 */
+} benchLoad_t;
+
+static const char *const LoadName[] = {"idle", "held", "mixed"};
+
+static uint32_t Random(void)
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//打开本线程的缓存缺失计数器，失败返回-1
+static int Perf_Open(void)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+//随机负载下按概率翻转按键状态，与test/MyKeyScan_test.c相同
+static void Load_Step(benchLoad_t Load)
+{
+    if (Load != BENCH_MIXED) {
+        return;
+    }
+    for (int i = 0; i < BENCH_KEYS; i++) {
+        uint32_t r = Random() % 1000;
+        if (r < (Raw[i] ? 8U : 4U)) {
+            Raw[i] = !Raw[i];
+        }
+        if (r > 995) {
+            Raw[i] = !Raw[i];
+        }
+    }
+}
+
+//测量一种负载，Load_Step的耗时单独测量后扣除
+static void Bench_Run(benchLoad_t Load, int Fd)
+{
+    MyKeyHandle keys[BENCH_KEYS], key;
+    unsigned char event, click;
+    long long misses = -1;
+    double best = 1e30;
+
+    MyKey_Init();
+    for (int i = 0; i < BENCH_KEYS; i++) {
+        Raw[i] = (Load == BENCH_HELD);
+        MyKey_Register(&keys[i], KeyFuncs[i], 0x1F, 100, 1000);
+    }
+    //按住的按键先越过长按进入连续触发
+    for (int n = 0; n < 200; n++) {
+        MyKey_Scan(10);
+        while (MyKey_Read(&key, &event, &click) == 0) {
+        }
+    }
+
+    for (int r = 0; r < BENCH_REPEAT; r++) {
+        double t0, step, scan;
+
+        uint32_t seed = Seed;
+        t0 = Now();
+        for (long n = 0; n < BENCH_SCANS; n++) {
+            Load_Step(Load);
+        }
+        step = Now() - t0;
+        Seed = seed;
+
+        if (Fd >= 0) {
+            ioctl(Fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(Fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        t0 = Now();
+        for (long n = 0; n < BENCH_SCANS; n++) {
+            Load_Step(Load);
+            MyKey_Scan(10);
+            while (MyKey_Read(&key, &event, &click) == 0) {
+            }
+        }
+        scan = Now() - t0 - step;
+        if (Fd >= 0) {
+            long long count = 0;
+            ioctl(Fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(Fd, &count, sizeof(count)) == (ssize_t)sizeof(count) && (misses < 0 || count < misses)) {
+                misses = count;
+            }
+        }
+        if (scan < best) {
+            best = scan;
+        }
+    }
+    MyKey_Deinit();
+
+    printf("%-6s %7.2f ns/scan/key", LoadName[Load], best / BENCH_SCANS / BENCH_KEYS);
+    if (misses >= 0) {
+        printf("  %8.4f cache misses/scan", (double)misses / BENCH_SCANS);
+    }
+    printf("\r\n");
+}
+
+int main(void)
+{
+    int fd = Perf_Open();
+
+    if (fd < 0) {
+        printf("perf_event_open unavailable, cache misses not measured\r\n");
+    }
+    printf("%d keys, %d scans, best of %d\r\n", BENCH_KEYS, BENCH_SCANS, BENCH_REPEAT);
+    Bench_Run(BENCH_IDLE, fd);
+    Bench_Run(BENCH_HELD, fd);
+    Bench_Run(BENCH_MIXED, fd);
+    if (fd >= 0) {
+        close(fd);
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+/**
+  * @file       MyKeyConcurrent_test.c
+  * @author     mgdg
+  * @brief      并发注册、注销测试
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     一个线程不停地调用MyKey_Scan，多个线程同时注册和注销按键，检查：
+  *             同时有效的两个按键不会得到同一个序号；注销返回之后开始的扫描不会再调用该按键的读取函数；
+  *             复用的序号不会继承上一个按键的按下状态；全部注销之后所有序号都能回收。
+  *             编译运行（在仓库根目录），也要用-fsanitize=thread编译运行一次：
+  *             gcc -O2 -Wall -I. test/MyKeyConcurrent_test.c MyKeyDrive.c MyQueue.c -lpthread -o MyKeyConcurrent_test && ./MyKeyConcurrent_test
+  *             gcc -O1 -g -fsanitize=thread -I. test/MyKeyConcurrent_test.c MyKeyDrive.c MyQueue.c -lpthread -o MyKeyConcurrent_test && ./MyKeyConcurrent_test
+  *             全部通过返回0。
+  */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include "MyKeyDrive.h"
+
+#define TEST_THREADS                    (4)
+#define TEST_SLOTS                      (8)     /** 每个线程的读取函数个数 */
+#define TEST_ROUNDS                     (5000)  /** 每个线程的注册次数 */
+#define TEST_INTERVAL                   (10)
+
+static int Failed = 0;
+
+#define CHECK(cond, name)               do{int ok_ = (cond); printf("%s %s\r\n", ok_ ? "PASS" : "FAIL", name); if (!ok_) Failed++;}while(0)
+
+//每个读取函数对应一个注册槽，注销时记录注销返回时已经开始的扫描个数
+typedef struct {
+    int Registered;
+    int Level;
+    uint32_t RetiredAt;
+} testSlot_t;
+
+static testSlot_t Slots[TEST_THREADS * TEST_SLOTS];
+static uint32_t ScanStarted = 0;        /** 已经开始的扫描个数，扫描线程写入 */
+static uint32_t ScanCurrent = 0;        /** 正在进行的扫描的编号，只由扫描线程访问 */
+static int Owner[MYKEY_MAX_KEYS];       /** 持有每个序号的注册槽加1 */
+static int Stop = 0;
+static long LateCalls = 0;
+static long DuplicateIndex = 0;
+static long StaleState = 0;
+
+static int Slot_Read(int n)
+{
+    testSlot_t *slot = &Slots[n];
+    if (!__atomic_load_n(&slot->Registered, __ATOMIC_ACQUIRE) &&
+        (int32_t)(ScanCurrent - __atomic_load_n(&slot->RetiredAt, __ATOMIC_RELAXED)) > 0) {
+        __atomic_fetch_add(&LateCalls, 1, __ATOMIC_RELAXED);
+    }
+    return __atomic_load_n(&slot->Level, __ATOMIC_RELAXED);
+}
+
+#define SLOT_FUNC(n)                    static int Slot##n(void) { return Slot_Read(n); }
+SLOT_FUNC(0)  SLOT_FUNC(1)  SLOT_FUNC(2)  SLOT_FUNC(3)  SLOT_FUNC(4)  SLOT_FUNC(5)  SLOT_FUNC(6)  SLOT_FUNC(7)
+SLOT_FUNC(8)  SLOT_FUNC(9)  SLOT_FUNC(10) SLOT_FUNC(11) SLOT_FUNC(12) SLOT_FUNC(13) SLOT_FUNC(14) SLOT_FUNC(15)
+SLOT_FUNC(16) SLOT_FUNC(17) SLOT_FUNC(18) SLOT_FUNC(19) SLOT_FUNC(20) SLOT_FUNC(21) SLOT_FUNC(22) SLOT_FUNC(23)
+SLOT_FUNC(24) SLOT_FUNC(25) SLOT_FUNC(26) SLOT_FUNC(27) SLOT_FUNC(28) SLOT_FUNC(29) SLOT_FUNC(30) SLOT_FUNC(31)
+static const KeyStatusFunc SlotFuncs[TEST_THREADS * TEST_SLOTS] = {
+    Slot0,  Slot1,  Slot2,  Slot3,  Slot4,  Slot5,  Slot6,  Slot7,
+    Slot8,  Slot9,  Slot10, Slot11, Slot12, Slot13, Slot14, Slot15,
+    Slot16, Slot17, Slot18, Slot19, Slot20, Slot21, Slot22, Slot23,
+    Slot24, Slot25, Slot26, Slot27, Slot28, Slot29, Slot30, Slot31,
+};
+
+static void *ScanThread(void *Arg)
+{
+    MyKeyHandle key;
+    unsigned char event, click;
+    (void)Arg;
+    while (!__atomic_load_n(&Stop, __ATOMIC_ACQUIRE)) {
+        ScanCurrent++;
+        __atomic_store_n(&ScanStarted, ScanCurrent, __ATOMIC_SEQ_CST);
+        MyKey_Scan(TEST_INTERVAL);
+        while (MyKey_Read(&key, &event, &click) == 0) {
+        }
+    }
+    return NULL;
+}
+
+//等待至少Num次完整的扫描
+static void WaitScans(uint32_t Num)
+{
+    uint32_t start = __atomic_load_n(&ScanStarted, __ATOMIC_SEQ_CST);
+    while ((uint32_t)(__atomic_load_n(&ScanStarted, __ATOMIC_SEQ_CST) - start) <= Num) {
+        sched_yield();
+    }
+}
+
+static void *RegisterThread(void *Arg)
+{
+    int base = (int)(intptr_t)Arg * TEST_SLOTS;
+    MyKeyHandle keys[TEST_SLOTS] = {NULL};
+    uint32_t seed = (uint32_t)base + 1;
+
+    for (int round = 0; round < TEST_ROUNDS; round++) {
+        seed = seed * 1103515245 + 12345;
+        int s = (int)((seed >> 16) % TEST_SLOTS);
+        testSlot_t *slot = &Slots[base + s];
+        if (keys[s] == NULL) {
+            //先标记为已注册，注册成功之后的调用都是合法的
+            __atomic_store_n(&slot->Level, (int)((seed >> 8) & 1), __ATOMIC_RELAXED);
+            __atomic_store_n(&slot->Registered, 1, __ATOMIC_RELEASE);
+            if (MyKey_Register(&keys[s], SlotFuncs[base + s], 0x1F, 100, 300) != 0) {
+                keys[s] = NULL;
+                continue;
+            }
+            int index = MyKey_GetIndex(keys[s]);
+            int expected = 0;
+            if (index < 0 || !__atomic_compare_exchange_n(&Owner[index], &expected, base + s + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                __atomic_fetch_add(&DuplicateIndex, 1, __ATOMIC_RELAXED);
+            }
+            //松开的按键在新的位置上不能是按下状态
+            if ((seed >> 20) % 4 == 0 && __atomic_load_n(&slot->Level, __ATOMIC_RELAXED) == 0) {
+                uint32_t bitmap[MYKEY_SNAPSHOT_WORDS];
+                WaitScans(2);
+                MyKey_Snapshot(bitmap);
+                if (bitmap[index / 32] & (1UL << (index % 32))) {
+                    __atomic_fetch_add(&StaleState, 1, __ATOMIC_RELAXED);
+                }
+            }
+        } else {
+            int index = MyKey_GetIndex(keys[s]);
+            if (index >= 0) {
+                __atomic_store_n(&Owner[index], 0, __ATOMIC_RELEASE);
+            }
+            MyKey_Unregister(&keys[s]);
+            __atomic_store_n(&slot->RetiredAt, __atomic_load_n(&ScanStarted, __ATOMIC_SEQ_CST), __ATOMIC_RELAXED);
+            __atomic_store_n(&slot->Registered, 0, __ATOMIC_RELEASE);
+        }
+        if ((seed >> 24) % 8 == 0) {
+            WaitScans(1);
+        }
+    }
+    for (int s = 0; s < TEST_SLOTS; s++) {
+        if (keys[s] != NULL) {
+            int index = MyKey_GetIndex(keys[s]);
+            __atomic_store_n(&Owner[index], 0, __ATOMIC_RELEASE);
+            MyKey_Unregister(&keys[s]);
+        }
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t scan, workers[TEST_THREADS];
+
+    MyKey_Init();
+    pthread_create(&scan, NULL, ScanThread, NULL);
+    for (int t = 0; t < TEST_THREADS; t++) {
+        pthread_create(&workers[t], NULL, RegisterThread, (void *)(intptr_t)t);
+    }
+    for (int t = 0; t < TEST_THREADS; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    WaitScans(2);
+    __atomic_store_n(&Stop, 1, __ATOMIC_RELEASE);
+    pthread_join(scan, NULL);
+
+    printf("scans %u\r\n", ScanStarted);
+    CHECK(DuplicateIndex == 0, "live keys never share an index");
+    CHECK(LateCalls == 0, "no status read after unregister returned");
+    CHECK(StaleState == 0, "reused index does not inherit pressed state");
+
+    //全部注销并且扫描过之后，所有序号都能重新注册
+    MyKeyHandle keys[MYKEY_MAX_KEYS];
+    int num = 0;
+    while (num < MYKEY_MAX_KEYS && MyKey_RegisterInput(&keys[num], 0x1F, 100, 300) == 0) {
+        num++;
+    }
+    CHECK(num == MYKEY_MAX_KEYS, "all indexes are reclaimed");
+
+    MyKey_Deinit();
+    printf("%s\r\n", Failed ? "FAILED" : "ALL PASSED");
+    return Failed ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+/**
+  * @file       MyKeyFd_test.c
+  * @author     mgdg
+  * @brief      MyKeyFd管道测试
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     用管道代替输入设备，向管道写入struct input_event和struct gpio_v2_line_event记录，检查产生的按键事件。
+  *             编译运行（在仓库根目录）：
+  *             gcc -O2 -Wall -I. test/MyKeyFd_test.c MyKeyFd.c MyKeyDrive.c MyQueue.c -o MyKeyFd_test && ./MyKeyFd_test
+  *             全部通过返回0。
+  */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <linux/input.h>
+#include <linux/gpio.h>
+#include "MyKeyFd.h"
+
+#define MS                              (1000000ULL)
+
+static int Failed = 0;
+
+#define CHECK(cond, name)               do{int ok_ = (cond); printf("%s %s\r\n", ok_ ? "PASS" : "FAIL", name); if (!ok_) Failed++;}while(0)
+
+static uint64_t Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void WriteInput(int fd, uint64_t ns, unsigned int code, int value)
+{
+    struct input_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.input_event_sec = ns / 1000000000ULL;
+    ev.input_event_usec = (ns % 1000000000ULL) / 1000;
+    ev.type = EV_KEY;
+    ev.code = code;
+    ev.value = value;
+    if (write(fd, &ev, sizeof(ev)) != (ssize_t)sizeof(ev)) {
+        Failed++;
+    }
+}
+
+//统计按键产生的各种事件个数，下标为事件位序号
+static void Drain(MyKeyHandle Key, int Count[8])
+{
+    MyKeyHandle id;
+    unsigned char event, click;
+    while (MyKey_Read(&id, &event, &click) == 0) {
+        if (id == Key) {
+            Count[__builtin_ctz(event)]++;
+        }
+    }
+}
+
+//运行到所有按键空闲
+static void RunIdle(myKeyFdHandle_t Input, MyKeyHandle Key, int Count[8])
+{
+    for (int i = 0; i < 500 && !MyKey_Idle(); i++) {
+        MyKeyFd_Run(Input, 10, -1);
+        Drain(Key, Count);
+    }
+    Drain(Key, Count);
+}
+
+int main(void)
+{
+    int pipeA[2], pipeB[2];
+    int count[8];
+    MyKeyHandle keyA, keyB;
+
+    if (pipe(pipeA) != 0 || pipe(pipeB) != 0 || MyKey_Init() != 0) {
+        return 1;
+    }
+    myKeyFdHandle_t input = MyKeyFd_Create(CLOCK_MONOTONIC);
+    CHECK(input != NULL, "create");
+    CHECK(MyKeyFd_Register(input, &keyA, pipeA[0], KEY_A, MYKEY_EVENT_CLICK | MYKEY_EVENT_DBLCLICK, 100, 1000) == 0, "register input key");
+    CHECK(MyKeyFd_Register(input, &keyB, pipeB[0], 5, MYKEY_EVENT_LONG_PRESS | MYKEY_EVENT_REPEAT | MYKEY_EVENT_RELASE, 100, 1000) == 0, "register gpio key");
+    CHECK(MyKeyFd_Register(input, &keyB, pipeB[0], 5, MYKEY_EVENT_CLICK, 100, 1000) != 0, "reject duplicate (fd, code)");
+    CHECK(MyKeyFd_AddFd(input, pipeA[0], MYKEYFD_FORMAT_INPUT) == 0, "add input fd");
+    CHECK(MyKeyFd_AddFd(input, pipeB[0], MYKEYFD_FORMAT_GPIO) == 0, "add gpio fd");
+
+    //已经过去的一批记录：80ms的按下按时间戳回放成单击，之后10ms的抖动被消抖滤掉
+    usleep(300 * 1000);
+    uint64_t t0 = Now() - 250 * MS;
+    WriteInput(pipeA[1], t0, KEY_A, 1);
+    WriteInput(pipeA[1], t0 + 80 * MS, KEY_A, 0);
+    WriteInput(pipeA[1], t0 + 100 * MS, KEY_A, 1);
+    WriteInput(pipeA[1], t0 + 110 * MS, KEY_A, 0);
+    CHECK(MyKeyFd_Run(input, 10, -1) == 4, "one wakeup reads the whole batch");
+    memset(count, 0, sizeof(count));
+    RunIdle(input, keyA, count);
+    CHECK(count[0] == 1 && count[1] == 0, "replayed batch gives one click");
+
+    //一条GPIO记录分两次写入，按下1.3s产生长按和连续触发，松开产生松开事件
+    struct gpio_v2_line_event ge;
+    memset(&ge, 0, sizeof(ge));
+    ge.id = GPIO_V2_LINE_EVENT_RISING_EDGE;
+    ge.offset = 5;
+    memset(count, 0, sizeof(count));
+    CHECK(write(pipeB[1], &ge, 20) == 20, "write partial gpio record");
+    MyKeyFd_Run(input, 10, 0);
+    CHECK(write(pipeB[1], (char *)&ge + 20, sizeof(ge) - 20) == (ssize_t)(sizeof(ge) - 20), "write rest of gpio record");
+    uint64_t start = Now();
+    while (Now() - start < 1300 * MS) {
+        MyKeyFd_Run(input, 10, -1);
+        Drain(keyB, count);
+    }
+    ge.id = GPIO_V2_LINE_EVENT_FALLING_EDGE;
+    CHECK(write(pipeB[1], &ge, sizeof(ge)) == (ssize_t)sizeof(ge), "write gpio release");
+    RunIdle(input, keyB, count);
+    CHECK(count[2] + count[3] > 0 && count[4] == 1, "gpio long press and release");
+
+    //按下时关闭写端，按键自动松开
+    memset(count, 0, sizeof(count));
+    WriteInput(pipeA[1], 0, KEY_A, 1);
+    start = Now();
+    while (Now() - start < 100 * MS) {
+        MyKeyFd_Run(input, 10, -1);
+    }
+    close(pipeA[1]);
+    RunIdle(input, keyA, count);
+    CHECK(count[0] == 1, "closed fd releases its keys");
+
+    //空闲时按超时时间等待
+    start = Now();
+    CHECK(MyKeyFd_Run(input, 10, 50) == 0, "idle wait returns no records");
+    uint64_t waited = (Now() - start) / MS;
+    CHECK(waited >= 45 && waited < 500, "idle wait honours the timeout");
+
+    MyKeyFd_Delete(input);
+    close(pipeA[0]);
+    close(pipeB[0]);
+    close(pipeB[1]);
+    MyKey_Deinit();
+    printf("%s\r\n", Failed ? "FAILED" : "ALL PASSED");
+    return Failed ? 1 : 0;
+}
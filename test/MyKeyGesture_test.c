@@ -0,0 +1,178 @@
+/**
+  * @file       MyKeyGesture_test.c
+  * @author     mgdg
+  * @brief      手势状态机测试
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     随机按键输入，把MyKey_GestureCompile生成的确定有限状态机的输出与逐个手势模拟的非确定有限状态机比较。
+  *             手势之间有共同的前缀和后缀，一个事件可以同时完成多个手势，并且使用了多个不同的间隔门限。
+  *             编译运行（在仓库根目录）：
+  *             gcc -O2 -Wall -I. test/MyKeyGesture_test.c MyKeyDrive.c MyQueue.c -o MyKeyGesture_test && ./MyKeyGesture_test
+  *             全部通过返回0。
+  */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "MyKeyDrive.h"
+
+#define TEST_KEYS                       (3)
+#define TEST_GESTURES                   (8)
+#define TEST_SCANS                      (3000000L)
+#define TEST_INTERVAL                   (5)
+
+static int Failed = 0;
+
+#define CHECK(cond, name)               do{int ok_ = (cond); printf("%s %s\r\n", ok_ ? "PASS" : "FAIL", name); if (!ok_) Failed++;}while(0)
+
+static int Raw[TEST_KEYS];
+static int Key0Status(void) { return Raw[0]; }
+static int Key1Status(void) { return Raw[1]; }
+static int Key2Status(void) { return Raw[2]; }
+static const KeyStatusFunc Sources[TEST_KEYS] = { Key0Status, Key1Status, Key2Status };
+
+static uint32_t Seed = 99;
+static uint32_t Random(void)
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+//手势按按键序号描述，注册之后转换为按键句柄
+typedef struct {
+    int Num;
+    size_t Timeout;
+    int Key[MYKEY_GESTURE_MAX_STEPS];
+    unsigned char EventMask[MYKEY_GESTURE_MAX_STEPS];
+} testGesture_t;
+
+#define C                               MYKEY_EVENT_CLICK
+#define D                               MYKEY_EVENT_DBLCLICK
+#define L                               MYKEY_EVENT_LONG_PRESS
+#define R                               MYKEY_EVENT_REPEAT
+#define U                               MYKEY_EVENT_RELASE
+
+static const testGesture_t Gestures[TEST_GESTURES] = {
+    { 2, 1000, { 0, 0 },       { C, L } },
+    { 3, 1500, { 0, 1, 0 },    { C, C, C } },
+    { 1, 0,    { 1 },          { D } },
+    { 3, 700,  { 2, 2, 2 },    { C | D, C | D, R } },
+    { 4, 1500, { 0, 1, 0, 1 }, { C, C, C, C } },
+    { 2, 1500, { 1, 0 },       { C, C } },
+    { 2, 300,  { 1, 2 },       { U, U } },
+    { 3, 2000, { 2, 0, 0 },    { C, C | D, L } },
+};
+
+//参考实现：每个手势独立记录已经匹配的步数集合，所有手势共用一个事件集合和上一个事件的时间
+static int Active[TEST_GESTURES][MYKEY_GESTURE_MAX_STEPS];
+static uint64_t LastTime = 0;
+
+static bool Reference_Used(int Key, unsigned char Event)
+{
+    for (int p = 0; p < TEST_GESTURES; p++) {
+        for (int k = 0; k < Gestures[p].Num; k++) {
+            if (Gestures[p].Key[k] == Key && (Gestures[p].EventMask[k] & Event)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static uint32_t Reference_Step(int Key, unsigned char Event, uint64_t Now)
+{
+    int next[TEST_GESTURES][MYKEY_GESTURE_MAX_STEPS] = {{0}};
+    uint32_t match = 0;
+
+    if (!Reference_Used(Key, Event)) {
+        return 0;
+    }
+    uint64_t gap = Now - LastTime;
+    LastTime = Now;
+    for (int p = 0; p < TEST_GESTURES; p++) {
+        const testGesture_t *g = &Gestures[p];
+        for (int k = 0; k < g->Num; k++) {
+            if (g->Key[k] != Key || !(g->EventMask[k] & Event)) {
+                continue;
+            }
+            if (k > 0 && (!Active[p][k] || (g->Timeout && gap > g->Timeout))) {
+                continue;
+            }
+            if (k + 1 == g->Num) {
+                match |= 1UL << p;
+            } else {
+                next[p][k + 1] = 1;
+            }
+        }
+    }
+    memcpy(Active, next, sizeof(Active));
+    return match;
+}
+
+int main(void)
+{
+    MyKeyHandle keys[TEST_KEYS];
+    long events = 0, gestures = 0, multiple = 0, bad = 0;
+    uint32_t expect = 0;
+    uint64_t now = 0;
+
+    MyKey_Init();
+    for (int i = 0; i < TEST_KEYS; i++) {
+        MyKey_Register(&keys[i], Sources[i], 0x1F, 200, 800);
+    }
+    for (int p = 0; p < TEST_GESTURES; p++) {
+        MyKeyGestureStep_t steps[MYKEY_GESTURE_MAX_STEPS];
+        for (int k = 0; k < Gestures[p].Num; k++) {
+            steps[k].Key = keys[Gestures[p].Key[k]];
+            steps[k].EventMask = Gestures[p].EventMask[k];
+        }
+        if (MyKey_GestureAdd(steps, Gestures[p].Num, Gestures[p].Timeout) != p) {
+            Failed++;
+        }
+    }
+    CHECK(Failed == 0, "add gestures");
+    CHECK(MyKey_GestureCompile() > 0, "compile gestures");
+
+    for (long t = 0; t < TEST_SCANS; t++) {
+        for (int i = 0; i < TEST_KEYS; i++) {
+            if (Random() % (Raw[i] ? 60 : 400) == 0) {
+                Raw[i] = !Raw[i];
+            }
+        }
+        MyKey_Scan(TEST_INTERVAL);
+        now += TEST_INTERVAL;
+
+        MyKeyHandle key;
+        unsigned char event, click;
+        while (MyKey_Read(&key, &event, &click) == 0) {
+            if (event == MYKEY_EVENT_GESTURE) {
+                //手势事件紧跟在触发它的事件之后，按序号从小到大输出
+                if (!(expect & (1UL << click)) || (expect & ((1UL << click) - 1))) {
+                    bad++;
+                }
+                expect &= ~(1UL << click);
+                gestures++;
+            } else {
+                if (expect) {
+                    bad++;
+                }
+                expect = Reference_Step(MyKey_GetIndex(key), event, now);
+                if (expect & (expect - 1)) {
+                    multiple++;
+                }
+                events++;
+            }
+        }
+    }
+    printf("events %ld, gestures %ld, multiple matches %ld, mismatches %ld\r\n", events, gestures, multiple, bad);
+    CHECK(gestures > 0 && multiple > 0, "trace exercises single and multiple matches");
+    CHECK(bad == 0 && expect == 0, "automaton matches the reference");
+
+    MyKey_GestureClear();
+    MyKey_Deinit();
+    printf("%s\r\n", Failed ? "FAILED" : "ALL PASSED");
+    return Failed ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+/**
+  * @file       MyKeyImage_test.c
+  * @author     mgdg
+  * @brief      按键表镜像测试
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     保存、装载、再保存的镜像必须一致，装载的按键与直接注册的按键产生相同的事件序列。
+  *             镜像的时间单位为ms，用us计时单位编译时还检查不是整数ms的时间不能保存。
+  *             编译运行（在仓库根目录），ms和us两种计时单位都要运行：
+  *             gcc -O2 -Wall -I. test/MyKeyImage_test.c MyKeyDrive.c MyQueue.c -o MyKeyImage_test && ./MyKeyImage_test
+  *             gcc -O2 -Wall -I. -DMYKEY_TICKS_PER_MS=1000 test/MyKeyImage_test.c MyKeyDrive.c MyQueue.c -o MyKeyImage_test && ./MyKeyImage_test
+  *             全部通过返回0。
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "MyKeyDrive.h"
+
+#define MS(t)                           ((size_t)(t) * MYKEY_TICKS_PER_MS)
+
+static int Failed = 0;
+
+#define CHECK(cond, name)               do{int ok_ = (cond); printf("%s %s\r\n", ok_ ? "PASS" : "FAIL", name); if (!ok_) Failed++;}while(0)
+
+static int Raw[3];
+static int Key0Status(void) { return Raw[0]; }
+static int Key1Status(void) { return Raw[1]; }
+static int Key2Status(void) { return Raw[2]; }
+static int AdcValue = 0;
+static int AdcSample(void) { return AdcValue; }
+
+static const KeyStatusFunc Sources[] = { Key0Status, Key1Status, Key2Status };
+static const uint16_t Thresholds[] = { 100, 200, 300 };
+static const uint8_t Image[] = {
+    MYKEY_IMAGE_HEAD(4),
+    MYKEY_IMAGE_KEY(2, 0x1F, 100, 1000),
+    MYKEY_IMAGE_KEY(0, 0x01, 0, 0),
+    MYKEY_IMAGE_ADC_KEY(0, 1, 0x1F, 50, 300),
+    MYKEY_IMAGE_KEY(1, 0x04, 0, 700),
+};
+
+//随机按键输入，返回事件序列的哈希
+static uint32_t Run(void)
+{
+    uint32_t hash = 2166136261UL;
+    MyKeyHandle key;
+    unsigned char event, click;
+
+    srand(1);
+    memset(Raw, 0, sizeof(Raw));
+    AdcValue = 0;
+    for (int t = 0; t < 20000; t++) {
+        for (int i = 0; i < 3; i++) {
+            if (rand() % 50 == 0) {
+                Raw[i] ^= 1;
+            }
+        }
+        if (rand() % 60 == 0) {
+            AdcValue = rand() % 400;
+        }
+        MyKey_Scan(MS(5));
+        while (MyKey_Read(&key, &event, &click) == 0) {
+            uint32_t v = (uint32_t)MyKey_GetIndex(key) << 16 | (uint32_t)event << 8 | click;
+            hash = (hash ^ v) * 16777619UL;
+        }
+    }
+    return hash;
+}
+
+int main(void)
+{
+    MyKeyAdcHandle adc;
+    MyKeyHandle keys[4];
+    uint8_t buf[64];
+
+    //装载、保存的镜像与原镜像一致
+    MyKey_Init();
+    MyKey_AdcCreate(&adc, AdcSample, Thresholds, 3, 5);
+    CHECK(MyKey_LoadImage(Image, sizeof(Image), Sources, 3, keys) == 4, "load image");
+    CHECK(MyKey_LoadImage(Image, sizeof(Image), Sources, 3, NULL) < 0, "reject load into a non-empty table");
+    CHECK(MyKey_SaveImage(NULL, 0, Sources, 3) == (int)sizeof(Image), "image size");
+    int size = MyKey_SaveImage(buf, sizeof(buf), Sources, 3);
+    CHECK(size == (int)sizeof(Image) && memcmp(buf, Image, sizeof(Image)) == 0, "saved image equals loaded image");
+    uint32_t loaded = Run();
+    MyKey_Deinit();
+
+    //直接注册相同的按键，事件序列必须相同，保存的镜像也相同
+    MyKey_Init();
+    MyKey_AdcCreate(&adc, AdcSample, Thresholds, 3, 5);
+    MyKey_Register(&keys[0], Key2Status, 0x1F, MS(100), MS(1000));
+    MyKey_Register(&keys[1], Key0Status, 0x01, 0, 0);
+    MyKey_RegisterAdc(&keys[2], adc, 1, 0x1F, MS(50), MS(300));
+    MyKey_Register(&keys[3], Key1Status, 0x04, 0, MS(700));
+    size = MyKey_SaveImage(buf, sizeof(buf), Sources, 3);
+    CHECK(size == (int)sizeof(Image) && memcmp(buf, Image, sizeof(Image)) == 0, "registered keys save to the same image");
+    CHECK(Run() == loaded, "loaded keys behave like registered keys");
+    MyKey_Deinit();
+
+    //与注册时相同，重复的读取函数或者模拟按键区间使整个镜像装载失败
+    static const KeyStatusFunc aliased[] = { Key0Status, Key1Status, Key0Status };
+    static const uint8_t dupSource[] = { MYKEY_IMAGE_HEAD(2), MYKEY_IMAGE_KEY(1, 0x01, 0, 0), MYKEY_IMAGE_KEY(1, 0x1F, 100, 1000) };
+    static const uint8_t dupLevel[] = { MYKEY_IMAGE_HEAD(3), MYKEY_IMAGE_ADC_KEY(0, 2, 0x01, 0, 0),
+                                        MYKEY_IMAGE_KEY(0, 0x01, 0, 0), MYKEY_IMAGE_ADC_KEY(0, 2, 0x1F, 0, 0) };
+    static const uint8_t twoLevels[] = { MYKEY_IMAGE_HEAD(2), MYKEY_IMAGE_ADC_KEY(0, 1, 0x01, 0, 0), MYKEY_IMAGE_ADC_KEY(0, 2, 0x01, 0, 0) };
+    MyKey_Init();
+    MyKey_AdcCreate(&adc, AdcSample, Thresholds, 3, 5);
+    CHECK(MyKey_LoadImage(dupSource, sizeof(dupSource), Sources, 3, NULL) < 0, "reject duplicate source");
+    uint8_t aliasImage[] = { MYKEY_IMAGE_HEAD(2), MYKEY_IMAGE_KEY(0, 0x01, 0, 0), MYKEY_IMAGE_KEY(2, 0x01, 0, 0) };
+    CHECK(MyKey_LoadImage(aliasImage, sizeof(aliasImage), aliased, 3, NULL) < 0, "reject two sources with the same function");
+    CHECK(MyKey_LoadImage(dupLevel, sizeof(dupLevel), Sources, 3, NULL) < 0, "reject duplicate adc level");
+    CHECK(MyKey_SaveImage(NULL, 0, Sources, 3) == MYKEY_IMAGE_SIZE(0), "failed loads register nothing");
+    CHECK(MyKey_LoadImage(twoLevels, sizeof(twoLevels), Sources, 3, NULL) == 2, "distinct adc levels load");
+    MyKey_Deinit();
+
+#if MYKEY_TICKS_PER_MS > 1
+    //不是整数ms的时间保存后会被截断，必须失败
+    MyKey_Init();
+    MyKey_Register(&keys[0], Key0Status, 0x1F, MS(1) + MYKEY_TICKS_PER_MS / 2, MS(2) + MYKEY_TICKS_PER_MS / 2);
+    CHECK(MyKey_SaveImage(buf, sizeof(buf), Sources, 3) < 0, "reject repeat/long press that are not whole ms");
+    MyKey_Unregister(&keys[0]);
+    MyKey_Register(&keys[0], Key0Status, 0x1F, MS(100), MYKEY_TICKS_PER_MS / 2);
+    CHECK(MyKey_SaveImage(buf, sizeof(buf), Sources, 3) < 0, "reject sub-ms long press");
+    MyKey_Deinit();
+#endif
+
+    printf("%s\r\n", Failed ? "FAILED" : "ALL PASSED");
+    return Failed ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+/**
+  * @file       MyKeyScan_test.c
+  * @author     mgdg
+  * @brief      扫描结果等价性测试
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     32个按键使用全部检测模式组合和随机的连续触发周期、长按时间，随机抖动400000次扫描，
+  *             扫描间隔在1、5、10、20ms之间切换。所有按键事件按顺序计算FNV-1a哈希，与重构计时内核之前
+  *             逐个处理按键的版本得到的哈希比较，计时内核的SIMD、标量实现和探测函数都不能改变事件序列。
+  *             只使用MyKey_Init、MyKey_Register、MyKey_Scan和MyKey_Read，也可以与旧版本一起编译得到参考值。
+  *             编译运行（在仓库根目录），下面四种编译方式都要运行：
+  *             gcc -O2 -Wall -I. test/MyKeyScan_test.c MyKeyDrive.c MyQueue.c -o MyKeyScan_test && ./MyKeyScan_test
+  *             gcc -O2 -Wall -mavx2 -I. test/MyKeyScan_test.c MyKeyDrive.c MyQueue.c -o MyKeyScan_test && ./MyKeyScan_test
+  *             gcc -O2 -Wall -U__SSE2__ -I. test/MyKeyScan_test.c MyKeyDrive.c MyQueue.c -o MyKeyScan_test && ./MyKeyScan_test
+  *             gcc -O2 -Wall -DTEST_PROBE -I. test/MyKeyScan_test.c MyKeyDrive.c MyQueue.c -o MyKeyScan_test && ./MyKeyScan_test
+  *             全部通过返回0。
+  */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "MyKeyDrive.h"
+
+#define TEST_KEYS                       (32)
+#define TEST_SCANS                      (400000)
+#define TEST_HASH                       (0x2F1F376EUL)  /** 参考版本得到的事件哈希 */
+
+static int Failed = 0;
+
+#define CHECK(cond, name)               do{int ok_ = (cond); printf("%s %s\r\n", ok_ ? "PASS" : "FAIL", name); if (!ok_) Failed++;}while(0)
+
+static int Raw[TEST_KEYS];
+static uint32_t Seed = 12345;
+
+#define KEY_FUNC(n)                     static int Key##n(void) { return Raw[n]; }
+KEY_FUNC(0)  KEY_FUNC(1)  KEY_FUNC(2)  KEY_FUNC(3)  KEY_FUNC(4)  KEY_FUNC(5)  KEY_FUNC(6)  KEY_FUNC(7)
+KEY_FUNC(8)  KEY_FUNC(9)  KEY_FUNC(10) KEY_FUNC(11) KEY_FUNC(12) KEY_FUNC(13) KEY_FUNC(14) KEY_FUNC(15)
+KEY_FUNC(16) KEY_FUNC(17) KEY_FUNC(18) KEY_FUNC(19) KEY_FUNC(20) KEY_FUNC(21) KEY_FUNC(22) KEY_FUNC(23)
+KEY_FUNC(24) KEY_FUNC(25) KEY_FUNC(26) KEY_FUNC(27) KEY_FUNC(28) KEY_FUNC(29) KEY_FUNC(30) KEY_FUNC(31)
+static const KeyStatusFunc KeyFuncs[TEST_KEYS] = {
+    Key0,  Key1,  Key2,  Key3,  Key4,  Key5,  Key6,  Key7,
+    Key8,  Key9,  Key10, Key11, Key12, Key13, Key14, Key15,
+    Key16, Key17, Key18, Key19, Key20, Key21, Key22, Key23,
+    Key24, Key25, Key26, Key27, Key28, Key29, Key30, Key31,
+};
+
+static uint32_t Random(void)
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static uint32_t Hash(uint32_t h, uint32_t Value)
+{
+    for (int n = 0; n < 4; n++) {
+        h = (h ^ ((Value >> (n * 8)) & 0xFF)) * 16777619UL;
+    }
+    return h;
+}
+
+#ifdef TEST_PROBE
+static int Probe(void)
+{
+    for (int i = 0; i < TEST_KEYS; i++) {
+        if (Raw[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif
+
+int main(void)
+{
+    static const size_t interval[] = {1, 5, 10, 20};
+    MyKeyHandle keys[TEST_KEYS];
+    uint32_t hash = 2166136261UL;
+    long events = 0;
+    int registered = 0;
+
+    MyKey_Init();
+#ifdef TEST_PROBE
+    MyKey_SetProbe(Probe);
+#endif
+    for (int i = 0; i < TEST_KEYS; i++) {
+        size_t repeat = 50 + Random() % 200;
+        size_t longPress = 300 + Random() % 1500;
+        registered += (MyKey_Register(&keys[i], KeyFuncs[i], (unsigned char)(i & 31), repeat, longPress) == 0);
+    }
+    CHECK(registered == TEST_KEYS, "all keys registered");
+
+    for (long t = 0; t < TEST_SCANS; t++) {
+        MyKeyHandle key;
+        unsigned char event, click;
+        //松开时千分之四、按下时千分之八的概率翻转，另有千分之四的概率再翻转一次形成抖动
+        for (int i = 0; i < TEST_KEYS; i++) {
+            uint32_t r = Random() % 1000;
+            if (r < (Raw[i] ? 8U : 4U)) {
+                Raw[i] = !Raw[i];
+            }
+            if (r > 995) {
+                Raw[i] = !Raw[i];
+            }
+        }
+        MyKey_Scan(interval[(t / 1000) % 4]);
+        while (MyKey_Read(&key, &event, &click) == 0) {
+            int j = 0;
+            while (j < TEST_KEYS && keys[j] != key) {
+                j++;
+            }
+            hash = Hash(hash, (uint32_t)t);
+            hash = Hash(hash, (uint32_t)j | ((uint32_t)event << 8) | ((uint32_t)click << 16));
+            events++;
+        }
+    }
+    printf("events %ld hash 0x%08lX\r\n", events, (unsigned long)hash);
+    CHECK(hash == TEST_HASH, "event sequence matches the reference");
+
+    printf("%s\r\n", Failed ? "FAILED" : "ALL PASSED");
+    return Failed ? 1 : 0;
+}
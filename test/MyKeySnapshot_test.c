@@ -0,0 +1,100 @@
+/**
+  * @file       MyKeySnapshot_test.c
+  * @author     mgdg
+  * @brief      MyKey_Snapshot测试
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     在内联回调和延迟回调中调用MyKey_Snapshot不能死等，并且分别得到上一次和本次扫描完成之后的状态；
+  *             另一个线程在扫描期间不停地取快照，每次都必须是某一次扫描完成之后的状态。
+  *             编译运行（在仓库根目录）：
+  *             gcc -O2 -Wall -I. test/MyKeySnapshot_test.c MyKeyDrive.c MyQueue.c -lpthread -o MyKeySnapshot_test && ./MyKeySnapshot_test
+  *             全部通过返回0，死等时3秒后被SIGALRM终止。
+  */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "MyKeyDrive.h"
+
+#define TEST_KEYS                       (2)
+#define TEST_SCANS                      (200000)
+
+static int Failed = 0;
+
+#define CHECK(cond, name)               do{int ok_ = (cond); printf("%s %s\r\n", ok_ ? "PASS" : "FAIL", name); if (!ok_) Failed++;}while(0)
+
+static int Raw[TEST_KEYS];
+static int Key0Status(void) { return Raw[0]; }
+static int Key1Status(void) { return Raw[1]; }
+
+static int Calls = 0;
+static int BadInCallback = 0;
+
+//按下时产生单击，松开时产生松开事件。内联回调在本次扫描中执行，得到的是上一次扫描完成之后的状态；
+//延迟回调在本次扫描完成之后执行，得到的是本次扫描之后的状态
+static void SnapshotCallback(MyKeyHandle KeyID, unsigned char KeyEvent, unsigned char KeyClickCount)
+{
+    uint32_t bitmap[MYKEY_SNAPSHOT_WORDS];
+    (void)KeyClickCount;
+    MyKey_Snapshot(bitmap);
+    int index = MyKey_GetIndex(KeyID);
+    int pressed = (bitmap[0] >> index) & 1;
+    int expect = (KeyEvent == MYKEY_EVENT_CLICK) ? (index == 1) : (index == 0);
+    if (pressed != expect) {
+        BadInCallback++;
+    }
+    Calls++;
+}
+
+//两个按键总是同时按下和松开，完成的扫描之后两位必须相同
+static int Stop = 0;
+static long Torn = 0;
+static long Snapshots = 0;
+
+static void *SnapshotThread(void *Arg)
+{
+    uint32_t bitmap[MYKEY_SNAPSHOT_WORDS];
+    (void)Arg;
+    while (!__atomic_load_n(&Stop, __ATOMIC_RELAXED)) {
+        MyKey_Snapshot(bitmap);
+        uint32_t bits = bitmap[0] & 0x3U;
+        if (bits == 0x1U || bits == 0x2U) {
+            Torn++;
+        }
+        Snapshots++;
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    MyKeyHandle keys[TEST_KEYS];
+    pthread_t thread;
+
+    alarm(3);
+    if (MyKey_Init() != 0) {
+        return 1;
+    }
+    CHECK(MyKey_Register(&keys[0], Key0Status, MYKEY_EVENT_CLICK, 100, 1000) == 0, "register key 0");
+    CHECK(MyKey_Register(&keys[1], Key1Status, MYKEY_EVENT_CLICK, 100, 1000) == 0, "register key 1");
+    CHECK(MyKey_SetCallback(keys[0], SnapshotCallback, MYKEY_CALLBACK_INLINE) == 0, "inline callback");
+    CHECK(MyKey_SetCallback(keys[1], SnapshotCallback, MYKEY_CALLBACK_DEFERRED) == 0, "deferred callback");
+
+    pthread_create(&thread, NULL, SnapshotThread, NULL);
+    for (int t = 0; t < TEST_SCANS; t++) {
+        //按下100ms，松开900ms
+        Raw[0] = Raw[1] = ((t % 1000) < 100);
+        MyKey_Scan(1);
+    }
+    __atomic_store_n(&Stop, 1, __ATOMIC_RELAXED);
+    pthread_join(thread, NULL);
+
+    CHECK(Calls == 4 * TEST_SCANS / 1000, "callbacks ran without blocking");
+    CHECK(BadInCallback == 0, "snapshot in callback shows the last completed scan");
+    CHECK(Snapshots > 0 && Torn == 0, "concurrent snapshots are consistent");
+
+    MyKey_Deinit();
+    printf("%s\r\n", Failed ? "FAILED" : "ALL PASSED");
+    return Failed ? 1 : 0;
+}
@@ -0,0 +1,169 @@
+/**
+  * @file       MyQueue_test.c
+  * @author     mgdg
+  * @brief      变长记录队列测试
+  * @version    v1.0
+  * @date       2026-10-18
+  * @remark     检查记录在缓冲区末尾回绕、尾部空间不够时的跳过标记、预留和提交、超长记录的拒绝
+  *             （32位size_t上(size_t)-3的RECORD_SPACE会溢出为4），以及随机长度记录长时间读写后内容和顺序不变。
+  *             编译运行（在仓库根目录）：
+  *             gcc -O2 -Wall -I. test/MyQueue_test.c MyQueue.c -o MyQueue_test && ./MyQueue_test
+  *             全部通过返回0。
+  */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "MyQueue.h"
+
+static int Failed = 0;
+
+#define CHECK(cond, name)               do{int ok_ = (cond); printf("%s %s\r\n", ok_ ? "PASS" : "FAIL", name); if (!ok_) Failed++;}while(0)
+
+//记录内容由序号和长度决定，读出时可以校验
+static void Fill(uint8_t *buf, size_t len, uint32_t seq)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(seq * 31 + i);
+    }
+}
+
+static bool Verify(const uint8_t *buf, size_t len, uint32_t seq)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] != (uint8_t)(seq * 31 + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool Put(myQueueHandle_t queue, size_t len, uint32_t seq)
+{
+    uint8_t buf[256];
+    Fill(buf, len, seq);
+    return myQueuePutRecord(queue, buf, len);
+}
+
+static bool Get(myQueueHandle_t queue, size_t expect, uint32_t seq)
+{
+    uint8_t buf[256];
+    size_t len = 0;
+    return myQueueGetRecord(queue, buf, sizeof(buf), &len) && (len == expect) && Verify(buf, len, seq);
+}
+
+static void TestWrap(void)
+{
+    //64字节缓冲区，12字节记录占16字节
+    myQueueHandle_t queue = myQueueCreateRecord(64);
+    bool ok = Put(queue, 12, 0) && Put(queue, 12, 1) && Put(queue, 12, 2);
+    ok = ok && Get(queue, 12, 0) && Get(queue, 12, 1);
+    //正好写到缓冲区末尾，rear回到0
+    ok = ok && Put(queue, 12, 3);
+    //从缓冲区开头继续写，rear不能追上front
+    ok = ok && Put(queue, 12, 4);
+    CHECK(ok, "record ending exactly at the buffer end wraps rear to 0");
+    CHECK(!Put(queue, 12, 5), "full queue rejects a record that would make rear reach front");
+    CHECK(Get(queue, 12, 2) && Get(queue, 12, 3) && Get(queue, 12, 4), "wrapped records read back in order");
+    size_t len;
+    CHECK(myQueuePeekRecord(queue, &len) == NULL, "queue is empty after reading all records");
+    myQueueDelete(queue);
+}
+
+static void TestSkipMarker(void)
+{
+    //两条20字节记录（各占24字节）读完后front=rear=48，尾部只剩16字节，下一条24字节的记录从开头写入
+    myQueueHandle_t queue = myQueueCreateRecord(64);
+    bool ok = Put(queue, 20, 0) && Put(queue, 20, 1) && Get(queue, 20, 0) && Get(queue, 20, 1);
+    const uint8_t *p = myQueueReserve(queue, 20);
+    ok = ok && (p != NULL) && (((uintptr_t)p & 3) == 0);
+    uint8_t buf[20];
+    Fill(buf, sizeof(buf), 2);
+    if (p != NULL) {
+        memcpy((void *)p, buf, sizeof(buf));
+    }
+    ok = ok && myQueueCommit(queue, 20);
+    CHECK(ok, "record that does not fit at the tail is placed at the buffer start");
+    size_t len = 0;
+    const void *peek = myQueuePeekRecord(queue, &len);
+    CHECK(peek == p && len == 20, "reader follows the skip marker to the buffer start");
+    CHECK(Get(queue, 20, 2), "record after the skip marker is intact");
+    CHECK(Put(queue, 20, 3) && Get(queue, 20, 3), "queue keeps working after the skip");
+    myQueueDelete(queue);
+}
+
+static void TestReserve(void)
+{
+    myQueueHandle_t queue = myQueueCreateRecord(64);
+    CHECK(!myQueueCommit(queue, 4), "commit without reserve fails");
+    uint8_t *p = myQueueReserve(queue, 16);
+    CHECK(p != NULL && !myQueueCommit(queue, 17), "commit longer than reserved fails");
+    Fill(p, 5, 7);
+    CHECK(myQueueCommit(queue, 5) && Get(queue, 5, 7), "commit shorter than reserved");
+    CHECK(myQueuePutRecord(queue, NULL, 0), "zero-length record");
+    size_t len = 1;
+    CHECK(myQueueGetRecord(queue, NULL, 0, &len) && len == 0, "read zero-length record");
+    CHECK(Put(queue, 16, 8), "put record");
+    uint8_t small[8];
+    CHECK(!myQueueGetRecord(queue, small, sizeof(small), &len), "small buffer does not take the record");
+    CHECK(Get(queue, 16, 8), "record is still there after a failed get");
+    myQueueDelete(queue);
+}
+
+static void TestOversized(void)
+{
+    myQueueHandle_t queue = myQueueCreateRecord(64);
+    CHECK(myQueueReserve(queue, (size_t)-1) == NULL, "reject SIZE_MAX");
+    CHECK(myQueueReserve(queue, (size_t)-3) == NULL, "reject length whose space would overflow");
+    CHECK(myQueueReserve(queue, (size_t)0xFFFFFFFFUL) == NULL, "reject the wrap marker value");
+    CHECK(myQueueReserve(queue, 61) == NULL, "reject record longer than the buffer");
+    CHECK(myQueueReserve(queue, 60) == NULL, "reject record that needs the whole buffer");
+    CHECK(Put(queue, 56, 9) && Get(queue, 56, 9), "largest record fits an empty queue");
+    myQueueDelete(queue);
+}
+
+//随机长度随机读写，与记录序号比较内容和顺序
+static void TestRandom(void)
+{
+    myQueueHandle_t queue = myQueueCreateRecord(1000);
+    uint32_t seed = 1, written = 0, read = 0;
+    size_t lens[4096];
+    const void *last = NULL;
+    long wraps = 0, bad = 0;
+
+    for (long n = 0; n < 1000000; n++) {
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 3 != 0) {
+            size_t len = (seed >> 8) % 200;
+            if (written - read < 4096 && Put(queue, len, written)) {
+                lens[written % 4096] = len;
+                written++;
+            }
+        } else if (read != written) {
+            size_t len;
+            const void *peek = myQueuePeekRecord(queue, &len);
+            if (last != NULL && peek < last) {
+                wraps++;
+            }
+            last = peek;
+            if (!Get(queue, lens[read % 4096], read)) {
+                bad++;
+            }
+            read++;
+        }
+    }
+    printf("records %u, wraps %ld\r\n", written, wraps);
+    CHECK(bad == 0 && wraps > 0, "random lengths keep content and order across wraps");
+    myQueueDelete(queue);
+}
+
+int main(void)
+{
+    TestWrap();
+    TestSkipMarker();
+    TestReserve();
+    TestOversized();
+    TestRandom();
+    printf("%s\r\n", Failed ? "FAILED" : "ALL PASSED");
+    return Failed ? 1 : 0;
+}